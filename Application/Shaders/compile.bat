@@ -1,3 +1,7 @@
 C:/VulkanSDK/1.3.224.1/Bin/glslc.exe shader.vert -o vert.spv
 C:/VulkanSDK/1.3.224.1/Bin/glslc.exe shader.frag -o frag.spv
+C:/VulkanSDK/1.3.224.1/Bin/glslc.exe depth_prepass.vert -o depth_prepass_vert.spv
+C:/VulkanSDK/1.3.224.1/Bin/glslc.exe meshlet_cull.comp -o meshlet_cull.spv
+C:/VulkanSDK/1.3.224.1/Bin/glslc.exe upscale.vert -o upscale_vert.spv
+C:/VulkanSDK/1.3.224.1/Bin/glslc.exe upscale.frag -o upscale_frag.spv
 pause
\ No newline at end of file
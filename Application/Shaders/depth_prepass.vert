@@ -0,0 +1,33 @@
+#version 450
+
+// Same transform as shader.vert, the main pass only shades fragments whose depth equals what this wrote
+invariant gl_Position;
+
+layout(binding = 0) uniform UniformBufferObject 
+{
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+layout(std430, set = 1, binding = 1) readonly buffer Instances { mat4 models[]; } buffers[];
+
+// INSTANCE_BUFFER_BINDLESS_INDEX and NO_SCENE_INSTANCE in VulkanRenderer.cpp
+const uint INSTANCE_BUFFER = 1;
+const uint NO_SCENE_INSTANCE = 0xFFFFFFFF;
+
+// DrawConstants in VulkanRenderer.cpp
+layout(push_constant) uniform DrawConstants
+{
+    mat4 model;
+    uint materialIndex;
+    uint objectId;
+} draw;
+
+// Position-only stream, see Mesh::positionBuffer
+layout(location = 0) in vec2 inPosition;
+
+void main() 
+{
+    mat4 model = draw.objectId != NO_SCENE_INSTANCE ? buffers[INSTANCE_BUFFER].models[draw.objectId + gl_InstanceIndex] : draw.model;
+    gl_Position = ubo.proj * ubo.view * model * vec4(inPosition, 0.0, 1.0);
+}
@@ -1,9 +1,33 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+struct Material
+{
+    vec4 baseColor;
+    uint albedoTexture;
+};
+
+// Bindless set, see BindlessDescriptors.h
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+layout(std430, set = 1, binding = 1) readonly buffer Materials { Material materials[]; } buffers[];
+
+// MATERIAL_BUFFER_BINDLESS_INDEX in VulkanRenderer.cpp
+const uint MATERIAL_BUFFER = 0;
+
+layout(push_constant) uniform DrawConstants
+{
+    mat4 model;
+    uint materialIndex;
+    uint objectId;
+} draw;
 
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    Material material = buffers[MATERIAL_BUFFER].materials[draw.materialIndex];
+    vec4 albedo = texture(textures[nonuniformEXT(material.albedoTexture)], fragTexCoord);
+    outColor = vec4(fragColor, 1.0) * albedo * material.baseColor;
 }
\ No newline at end of file
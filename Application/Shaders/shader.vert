@@ -1,19 +1,40 @@
 #version 450
 
+// Has to match depth_prepass.vert bit for bit, the depth test compares against what the prepass wrote
+invariant gl_Position;
+
 layout(binding = 0) uniform UniformBufferObject 
 {
-    mat4 model;
     mat4 view;
     mat4 proj;
 } ubo;
 
+// Scene graph world matrices, the slot points at the instance buffer of the frame being rendered
+layout(std430, set = 1, binding = 1) readonly buffer Instances { mat4 models[]; } buffers[];
+
+// INSTANCE_BUFFER_BINDLESS_INDEX and NO_SCENE_INSTANCE in VulkanRenderer.cpp
+const uint INSTANCE_BUFFER = 1;
+const uint NO_SCENE_INSTANCE = 0xFFFFFFFF;
+
+// DrawConstants in VulkanRenderer.cpp
+layout(push_constant) uniform DrawConstants
+{
+    mat4 model;
+    uint materialIndex;
+    uint objectId;
+} draw;
+
 layout(location = 0) in vec2 inPosition;
 layout(location = 1) in vec3 inColor;
 
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
 
 void main() 
 {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 0.0, 1.0);
+    // Instanced draws cover consecutive matrices starting at objectId
+    mat4 model = draw.objectId != NO_SCENE_INSTANCE ? buffers[INSTANCE_BUFFER].models[draw.objectId + gl_InstanceIndex] : draw.model;
+    gl_Position = ubo.proj * ubo.view * model * vec4(inPosition, 0.0, 1.0);
     fragColor = inColor;
+    fragTexCoord = inPosition + vec2(0.5);
 }
\ No newline at end of file
@@ -0,0 +1,53 @@
+#version 450
+
+layout(binding = 0) uniform sampler2D sceneColor;
+
+// UpscaleConstants in VulkanRenderer.cpp
+layout(push_constant) uniform UpscaleConstants
+{
+    vec2 uvScale;
+    vec2 uvMax;
+    vec2 texelSize;
+    uint upscaler;
+    float sharpness;
+} upscale;
+
+// Upscaler in VulkanRenderer.h
+const uint UPSCALER_BILINEAR = 0;
+
+layout(location = 0) in vec2 inUV;
+
+layout(location = 0) out vec4 outColor;
+
+// Only the top left of the source holds this frame's scene, nothing may be read from outside of it
+vec3 fetch(vec2 uv)
+{
+    return texture(sceneColor, clamp(uv, upscale.texelSize * 0.5, upscale.uvMax)).rgb;
+}
+
+void main()
+{
+    vec2 uv = inUV * upscale.uvScale;
+    vec3 center = fetch(uv);
+    if (upscale.upscaler == UPSCALER_BILINEAR)
+    {
+        outColor = vec4(center, 1.0);
+        return;
+    }
+
+    // Contrast adaptive sharpening on top of the bilinear result. Flat areas and strong edges get little of it,
+    // so edges come back crisper without ringing and noise is not amplified.
+    vec3 north = fetch(uv - vec2(0.0, upscale.texelSize.y));
+    vec3 south = fetch(uv + vec2(0.0, upscale.texelSize.y));
+    vec3 west = fetch(uv - vec2(upscale.texelSize.x, 0.0));
+    vec3 east = fetch(uv + vec2(upscale.texelSize.x, 0.0));
+
+    vec3 minColor = min(center, min(min(north, south), min(west, east)));
+    vec3 maxColor = max(center, max(max(north, south), max(west, east)));
+
+    vec3 amount = sqrt(clamp(min(minColor, 1.0 - maxColor) / max(maxColor, 1e-4), 0.0, 1.0));
+    vec3 weight = -amount * mix(0.125, 0.2, upscale.sharpness);
+
+    vec3 sharpened = (center + (north + south + west + east) * weight) / (1.0 + 4.0 * weight);
+    outColor = vec4(clamp(sharpened, minColor, maxColor), 1.0);
+}
@@ -0,0 +1,10 @@
+#version 450
+
+layout(location = 0) out vec2 outUV;
+
+void main()
+{
+    // One triangle covering the screen, UVs run from 0 to 1 over the visible part
+    outUV = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(outUV * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -1,27 +1,39 @@
 #include "Application.h"
 #include "EntryPoint.h"
 #include "GameLayer.h"
+#include "SimulationStatsLayer.h"
+#include "JobSystem.h"
+#include "FrameTiming.h"
 
 #include  <iostream>
+#include <thread>
 
 Application* Application::s_Instance = nullptr;
 
-Application::Application(CommandLineArguments arg)
-	: m_CommandLineArguments(arg)
+Application::Application(CommandLineArguments arg, const ApplicationSpecification& specification)
+	: m_Specification(specification), m_CommandLineArguments(arg)
 {
 	if (s_Instance != nullptr)
 		return;
 			
 	s_Instance = this;  
 
+	// Started before any layer is attached, layers and the renderer may submit jobs from OnAttach on
+	FrameTiming::Initialize();
+	JobSystem::Initialize();
+
 	m_Window = new Window();
 	PushLayer(new GameLayer());
+	PushLayer(new SimulationStatsLayer());
 }
 
 Application::~Application()
 {
 	delete m_Window;
 	m_Window = nullptr;
+
+	JobSystem::Shutdown();
+	FrameTiming::Shutdown();
 }
 
 void Application::PushLayer(Layer* layer)
@@ -46,15 +58,67 @@ Window& Application::GetWindow()
 	return *m_Window;
 }
 
+// After falling this far behind the simulation drops time instead of trying to catch up
+static const uint32_t MAX_SIMULATION_STEPS_PER_UPDATE = 5;
+
+void Application::UpdateSimulation()
+{
+	double step = FrameTiming::GetFixedTimestep();
+	uint32_t steps = 0;
+
+	while (FrameTiming::Now() >= m_NextSimulationStep)
+	{
+		if (steps == MAX_SIMULATION_STEPS_PER_UPDATE)
+		{
+			m_NextSimulationStep = FrameTiming::Now();
+			break;
+		}
+
+		FrameTiming::SetSimulationTime(m_NextSimulationStep);
+		m_LayerStack.OnUpdate();
+
+		m_NextSimulationStep += step;
+		steps++;
+	}
+}
+
+void Application::RunSimulation()
+{
+	// Jobs of the simulation never run inside a wait of the render thread and the other way round
+	JobSystem::AttachThread();
+
+	while (m_Running)
+	{
+		UpdateSimulation();
+		FrameTiming::WaitUntil(m_NextSimulationStep);
+	}
+}
+
 void Application::Run()
 {
+	// GLFW events and the swap chain stay on the main thread, so that is where rendering happens
+	m_NextSimulationStep = FrameTiming::Now();
+
+	std::thread simulation;
+	if (m_Specification.EnableSimulationThread)
+		simulation = std::thread(&Application::RunSimulation, this);
 
 	while (m_Running)
 	{		
 		m_Window->OnUpdate();
-		m_Window->Close(m_Running);
 
-		m_LayerStack.OnUpdate();	
+		bool running = true;
+		m_Window->Close(running);
+		if (!running)
+			m_Running = false;
+
+		if (!m_Specification.EnableSimulationThread)
+			UpdateSimulation();
+
+		// Layers end the frame themselves, frames skipped by on-demand rendering are neither paced nor counted
+		m_LayerStack.OnRender();
 	}
 
+	if (simulation.joinable())
+		simulation.join();
 }
\ No newline at end of file
@@ -30,10 +30,20 @@ struct CommandLineArguments
 	char** m_buffer = nullptr;
 };
 
+#include <atomic>
+#include <cstring>
+
+struct ApplicationSpecification
+{
+	// Simulation runs on its own thread and talks to rendering through frame snapshots only,
+	// turning it off runs both on the main thread one after the other
+	bool EnableSimulationThread = true;
+};
+
 class Application
 {
 public:
-	Application(CommandLineArguments arg);
+	Application(CommandLineArguments arg, const ApplicationSpecification& specification = ApplicationSpecification());
 	~Application();
 
 	static Application& GetApp();
@@ -46,7 +56,15 @@ public:
 
 
 private:
-	bool m_Running = true;
+	void RunSimulation();
+	// Runs every fixed step that is due, never more than MAX_SIMULATION_STEPS_PER_UPDATE in a row
+	void UpdateSimulation();
+
+private:
+	std::atomic<bool> m_Running{ true };
+	ApplicationSpecification m_Specification;
+	// FrameTiming time the next fixed step is due
+	double m_NextSimulationStep = 0.0;
 	static Application* s_Instance;
 
 	CommandLineArguments m_CommandLineArguments;
@@ -63,5 +81,13 @@ Application* CreateApplication(int argc, char** argv)
 {
 	CommandLineArguments c_arg(argc, argv);
 
-	return new Application(c_arg);
+	// --single-thread runs simulation and rendering on the main thread, for debugging and profiling
+	ApplicationSpecification specification;
+	for (int i = 1; i < c_arg.m_Argc; i++)
+	{
+		if (strcmp(c_arg.GetData(i), "--single-thread") == 0)
+			specification.EnableSimulationThread = false;
+	}
+
+	return new Application(c_arg, specification);
 }
\ No newline at end of file
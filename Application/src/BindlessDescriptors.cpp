@@ -0,0 +1,271 @@
+#include "BindlessDescriptors.h"
+#include "Core.h"
+
+#include <vector>
+#include <array>
+#include <algorithm>
+
+namespace
+{
+    // Every frame in flight owns a copy of the set, a write reaches each copy once its frame is no longer on the GPU
+    struct PendingWrite
+    {
+        uint32_t binding;
+        uint32_t index;
+        VkDescriptorImageInfo imageInfo;
+        VkDescriptorBufferInfo bufferInfo;
+        uint32_t frameMask;
+    };
+
+    struct IndexAllocator
+    {
+        uint32_t capacity = 0;
+        uint32_t next = 0;
+        std::vector<uint32_t> freeIndices;
+
+        uint32_t Allocate()
+        {
+            if (!freeIndices.empty())
+            {
+                uint32_t index = freeIndices.back();
+                freeIndices.pop_back();
+                return index;
+            }
+
+            return next < capacity ? next++ : INVALID_BINDLESS_INDEX;
+        }
+
+        void Free(uint32_t index)
+        {
+            freeIndices.push_back(index);
+        }
+    };
+}
+
+struct BindlessData
+{
+    VkDevice device;
+    VkDescriptorSetLayout setLayout;
+    VkDescriptorPool descriptorPool;
+    std::vector<VkDescriptorSet> descriptorSets;
+    uint32_t allFramesMask = 0;
+
+    IndexAllocator textures;
+    IndexAllocator storageBuffers;
+    std::vector<PendingWrite> pendingWrites;
+};
+
+static BindlessData* s_BindlessData = nullptr;
+
+static void QueueWrite(const PendingWrite& write)
+{
+    // A newer write to the same slot replaces the older one for the frames that have not applied it yet
+    for (PendingWrite& pending : s_BindlessData->pendingWrites)
+    {
+        if (pending.binding == write.binding && pending.index == write.index && pending.frameMask == write.frameMask)
+        {
+            pending = write;
+            return;
+        }
+    }
+
+    s_BindlessData->pendingWrites.push_back(write);
+}
+
+void BindlessDescriptors::Initialize(VkDevice device, const BindlessLimits& limits, uint32_t framesInFlight)
+{
+    CheckForError(!limits.supported, "Descriptor indexing is not supported by this GPU!")
+
+    s_BindlessData = new BindlessData();
+    s_BindlessData->device = device;
+    s_BindlessData->allFramesMask = (1u << framesInFlight) - 1;
+    s_BindlessData->textures.capacity = std::min(MAX_BINDLESS_TEXTURES, limits.maxTextures);
+    s_BindlessData->storageBuffers.capacity = std::min(MAX_BINDLESS_STORAGE_BUFFERS, limits.maxStorageBuffers);
+
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    bindings[0].binding = BINDLESS_TEXTURE_BINDING;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = s_BindlessData->textures.capacity;
+    bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+
+    bindings[1].binding = BINDLESS_STORAGE_BUFFER_BINDING;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[1].descriptorCount = s_BindlessData->storageBuffers.capacity;
+    bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+    // Unused slots may stay empty and slots may be rewritten while the set is bound in a recording command buffer
+    std::array<VkDescriptorBindingFlags, 2> bindingFlags = {
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+    };
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+    bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &bindingFlagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    CheckForError(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &s_BindlessData->setLayout) != VK_SUCCESS, "Failed to create bindless descriptor set layout!")
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = s_BindlessData->textures.capacity * framesInFlight;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = s_BindlessData->storageBuffers.capacity * framesInFlight;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = framesInFlight;
+
+    CheckForError(vkCreateDescriptorPool(device, &poolInfo, nullptr, &s_BindlessData->descriptorPool) != VK_SUCCESS, "Failed to create bindless descriptor pool!")
+
+    std::vector<VkDescriptorSetLayout> layouts(framesInFlight, s_BindlessData->setLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = s_BindlessData->descriptorPool;
+    allocInfo.descriptorSetCount = framesInFlight;
+    allocInfo.pSetLayouts = layouts.data();
+
+    s_BindlessData->descriptorSets.resize(framesInFlight);
+    CheckForError(vkAllocateDescriptorSets(device, &allocInfo, s_BindlessData->descriptorSets.data()) != VK_SUCCESS, "Failed to allocate bindless descriptor sets!")
+}
+
+void BindlessDescriptors::Shutdown()
+{
+    vkDestroyDescriptorPool(s_BindlessData->device, s_BindlessData->descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(s_BindlessData->device, s_BindlessData->setLayout, nullptr);
+
+    delete s_BindlessData;
+    s_BindlessData = nullptr;
+}
+
+VkDescriptorSetLayout BindlessDescriptors::GetSetLayout()
+{
+    return s_BindlessData->setLayout;
+}
+
+void BindlessDescriptors::BeginFrame(uint32_t frameIndex)
+{
+    uint32_t frameBit = 1u << frameIndex;
+    std::vector<VkWriteDescriptorSet> writes;
+    writes.reserve(s_BindlessData->pendingWrites.size());
+
+    for (PendingWrite& pending : s_BindlessData->pendingWrites)
+    {
+        if ((pending.frameMask & frameBit) == 0)
+            continue;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = s_BindlessData->descriptorSets[frameIndex];
+        write.dstBinding = pending.binding;
+        write.dstArrayElement = pending.index;
+        write.descriptorCount = 1;
+
+        if (pending.binding == BINDLESS_TEXTURE_BINDING)
+        {
+            write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            write.pImageInfo = &pending.imageInfo;
+        }
+        else
+        {
+            write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            write.pBufferInfo = &pending.bufferInfo;
+        }
+
+        writes.push_back(write);
+        pending.frameMask &= ~frameBit;
+    }
+
+    if (!writes.empty())
+        vkUpdateDescriptorSets(s_BindlessData->device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+    auto& pendingWrites = s_BindlessData->pendingWrites;
+    pendingWrites.erase(std::remove_if(pendingWrites.begin(), pendingWrites.end(), [](const PendingWrite& pending) { return pending.frameMask == 0; }), pendingWrites.end());
+}
+
+VkDescriptorSet BindlessDescriptors::GetDescriptorSet(uint32_t frameIndex)
+{
+    return s_BindlessData->descriptorSets[frameIndex];
+}
+
+uint32_t BindlessDescriptors::RegisterTexture(VkImageView view, VkSampler sampler)
+{
+    uint32_t index = s_BindlessData->textures.Allocate();
+    CheckForError(index == INVALID_BINDLESS_INDEX, "Bindless texture array is full!")
+
+    UpdateTexture(index, view, sampler);
+    return index;
+}
+
+void BindlessDescriptors::UpdateTexture(uint32_t index, VkImageView view, VkSampler sampler)
+{
+    PendingWrite write{};
+    write.binding = BINDLESS_TEXTURE_BINDING;
+    write.index = index;
+    write.imageInfo.imageView = view;
+    write.imageInfo.sampler = sampler;
+    write.imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    write.frameMask = s_BindlessData->allFramesMask;
+
+    QueueWrite(write);
+}
+
+void BindlessDescriptors::ReleaseTexture(uint32_t index)
+{
+    // Partially bound slots may keep their stale descriptor, shaders never index a released slot
+    s_BindlessData->textures.Free(index);
+}
+
+uint32_t BindlessDescriptors::RegisterStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    uint32_t index = s_BindlessData->storageBuffers.Allocate();
+    CheckForError(index == INVALID_BINDLESS_INDEX, "Bindless storage buffer array is full!")
+
+    PendingWrite write{};
+    write.binding = BINDLESS_STORAGE_BUFFER_BINDING;
+    write.index = index;
+    write.bufferInfo.buffer = buffer;
+    write.bufferInfo.offset = offset;
+    write.bufferInfo.range = range;
+    write.frameMask = s_BindlessData->allFramesMask;
+
+    QueueWrite(write);
+    return index;
+}
+
+uint32_t BindlessDescriptors::RegisterFrameStorageBuffers(const VkBuffer* buffers, VkDeviceSize range)
+{
+    uint32_t index = s_BindlessData->storageBuffers.Allocate();
+    CheckForError(index == INVALID_BINDLESS_INDEX, "Bindless storage buffer array is full!")
+
+    // One write per frame, each frame's copy of the set only ever sees its own buffer
+    for (uint32_t frame = 0; frame < s_BindlessData->descriptorSets.size(); frame++)
+    {
+        PendingWrite write{};
+        write.binding = BINDLESS_STORAGE_BUFFER_BINDING;
+        write.index = index;
+        write.bufferInfo.buffer = buffers[frame];
+        write.bufferInfo.offset = 0;
+        write.bufferInfo.range = range;
+        write.frameMask = 1u << frame;
+
+        QueueWrite(write);
+    }
+
+    return index;
+}
+
+void BindlessDescriptors::ReleaseStorageBuffer(uint32_t index)
+{
+    s_BindlessData->storageBuffers.Free(index);
+}
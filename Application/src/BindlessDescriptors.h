@@ -0,0 +1,47 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <stdint.h>
+
+const uint32_t INVALID_BINDLESS_INDEX = UINT32_MAX;
+
+// Bindings of the bindless set, mirrored in the shaders
+const uint32_t BINDLESS_TEXTURE_BINDING = 0;
+const uint32_t BINDLESS_STORAGE_BUFFER_BINDING = 1;
+
+// Upper bounds of the two arrays, clamped to the device limits at initialization
+const uint32_t MAX_BINDLESS_TEXTURES = 16384;
+const uint32_t MAX_BINDLESS_STORAGE_BUFFERS = 4096;
+
+// Descriptor indexing support and limits, queried during physical device selection
+struct BindlessLimits
+{
+	bool supported = false;
+	uint32_t maxTextures = 0;
+	uint32_t maxStorageBuffers = 0;
+};
+
+// One partially bound, update-after-bind set holding every texture and storage buffer the renderer knows about.
+// Resources are addressed by their index in the shaders, so the set is bound once per frame instead of per draw.
+class BindlessDescriptors
+{
+public:
+	static void Initialize(VkDevice device, const BindlessLimits& limits, uint32_t framesInFlight);
+	static void Shutdown();
+
+	static VkDescriptorSetLayout GetSetLayout();
+
+	// Applies the writes this frame's set has not seen yet, call after the frame's fence has been waited on
+	static void BeginFrame(uint32_t frameIndex);
+	static VkDescriptorSet GetDescriptorSet(uint32_t frameIndex);
+
+	static uint32_t RegisterTexture(VkImageView view, VkSampler sampler);
+	static void UpdateTexture(uint32_t index, VkImageView view, VkSampler sampler);
+	static void ReleaseTexture(uint32_t index);
+
+	static uint32_t RegisterStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+	// Same slot in every frame's set, but frame N's set points at buffers[N], for data rewritten while other frames are in flight
+	static uint32_t RegisterFrameStorageBuffers(const VkBuffer* buffers, VkDeviceSize range);
+	static void ReleaseStorageBuffer(uint32_t index);
+};
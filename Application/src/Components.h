@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <stdint.h>
+
+// Components are plain data, the registry moves them around with memcpy when entities change archetype
+
+struct Transform
+{
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3 scale = glm::vec3(1.0f);
+};
+
+// Index into the renderer's mesh table
+struct MeshRef
+{
+	uint32_t mesh = 0;
+};
+
+// Index into the materials buffer
+struct MaterialRef
+{
+	uint32_t material = 0;
+};
+
+// Object space bounding sphere, xyz center and w radius
+struct Bounds
+{
+	glm::vec4 sphere = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+};
+
+enum ComponentType : uint32_t
+{
+	ComponentTransform = 0,
+	ComponentMesh,
+	ComponentMaterial,
+	ComponentBounds,
+	ComponentTypeCount
+};
+
+using ComponentMask = uint32_t;
+
+template<typename T>
+struct ComponentTraits;
+
+template<> struct ComponentTraits<Transform> { static const ComponentType type = ComponentTransform; };
+template<> struct ComponentTraits<MeshRef> { static const ComponentType type = ComponentMesh; };
+template<> struct ComponentTraits<MaterialRef> { static const ComponentType type = ComponentMaterial; };
+template<> struct ComponentTraits<Bounds> { static const ComponentType type = ComponentBounds; };
+
+template<typename... Ts>
+constexpr ComponentMask GetComponentMask()
+{
+	return ((1u << ComponentTraits<Ts>::type) | ... | 0u);
+}
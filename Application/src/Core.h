@@ -0,0 +1,6 @@
+#pragma once
+#include "spdlog/spdlog.h"
+
+#define DEBUG_BREAK __debugbreak();
+#define Print(x) spdlog::info(x);
+#define CheckForError(x,y) if(x) { spdlog::error(y); DEBUG_BREAK }
@@ -0,0 +1,168 @@
+#include "DescriptorAllocator.h"
+#include "Core.h"
+
+#include <unordered_map>
+#include <algorithm>
+
+namespace
+{
+    // Pools never grow beyond this many sets, larger demand is spread over several pools
+    const uint32_t MAX_SETS_PER_POOL = 4096;
+
+    using LayoutCounts = std::array<uint32_t, DESCRIPTOR_TYPE_COUNT>;
+}
+
+static std::unordered_map<VkDescriptorSetLayout, LayoutCounts> s_LayoutCounts;
+
+VkDescriptorSetLayout DescriptorAllocator::CreateSetLayout(VkDevice device, const VkDescriptorSetLayoutCreateInfo& createInfo)
+{
+    VkDescriptorSetLayout layout;
+    CheckForError(vkCreateDescriptorSetLayout(device, &createInfo, nullptr, &layout) != VK_SUCCESS, "Failed to create descriptor set layout!")
+
+    LayoutCounts counts{};
+    for (uint32_t i = 0; i < createInfo.bindingCount; i++)
+    {
+        const VkDescriptorSetLayoutBinding& binding = createInfo.pBindings[i];
+        if (binding.descriptorType < DESCRIPTOR_TYPE_COUNT)
+            counts[binding.descriptorType] += binding.descriptorCount;
+    }
+
+    s_LayoutCounts[layout] = counts;
+    return layout;
+}
+
+void DescriptorAllocator::DestroySetLayout(VkDevice device, VkDescriptorSetLayout layout)
+{
+    s_LayoutCounts.erase(layout);
+    vkDestroyDescriptorSetLayout(device, layout, nullptr);
+}
+
+void DescriptorAllocator::Init(VkDevice device, uint32_t initialSetsPerPool)
+{
+    m_Device = device;
+    m_SetsPerPool = initialSetsPerPool;
+}
+
+void DescriptorAllocator::Destroy()
+{
+    Reset();
+
+    for (VkDescriptorPool pool : m_FreePools)
+        vkDestroyDescriptorPool(m_Device, pool, nullptr);
+
+    m_FreePools.clear();
+}
+
+VkDescriptorPool DescriptorAllocator::CreatePool(uint32_t setCount, const std::array<uint32_t, DESCRIPTOR_TYPE_COUNT>& minimumCounts)
+{
+    // Scale the observed descriptor mix to the set count, rounding up so the average set always fits
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for (uint32_t type = 0; type < DESCRIPTOR_TYPE_COUNT; type++)
+    {
+        uint64_t count = (m_TotalDescriptors[type] * setCount + m_TotalSets - 1) / m_TotalSets;
+        count = std::max<uint64_t>(count, minimumCounts[type]);
+
+        if (count == 0)
+            continue;
+
+        poolSizes.push_back({ static_cast<VkDescriptorType>(type), static_cast<uint32_t>(count) });
+    }
+
+    // Layouts without descriptors still need a valid pool
+    if (poolSizes.empty())
+        poolSizes.push_back({ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 });
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = 0;
+    poolInfo.maxSets = setCount;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+
+    VkDescriptorPool pool;
+    CheckForError(vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &pool) != VK_SUCCESS, "Failed to create descriptor pool!")
+    return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::GrabPool(const std::array<uint32_t, DESCRIPTOR_TYPE_COUNT>& minimumCounts, bool reuse)
+{
+    if (reuse && !m_FreePools.empty())
+    {
+        VkDescriptorPool pool = m_FreePools.back();
+        m_FreePools.pop_back();
+        return pool;
+    }
+
+    VkDescriptorPool pool = CreatePool(m_SetsPerPool, minimumCounts);
+
+    // Each pool that has to be added doubles the size of the next one
+    m_SetsPerPool = std::min(m_SetsPerPool * 2, MAX_SETS_PER_POOL);
+    return pool;
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout)
+{
+    auto counts = s_LayoutCounts.find(layout);
+    CheckForError(counts == s_LayoutCounts.end(), "Descriptor set layout was not created through DescriptorAllocator!")
+
+    // The request counts as observed usage, so a pool created for it has room for its descriptor types
+    m_TotalSets++;
+    for (uint32_t type = 0; type < DESCRIPTOR_TYPE_COUNT; type++)
+        m_TotalDescriptors[type] += counts->second[type];
+
+    if (m_CurrentPool == VK_NULL_HANDLE)
+        m_CurrentPool = GrabPool(counts->second, true);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_CurrentPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    VkDescriptorSet descriptorSet;
+    VkResult result = vkAllocateDescriptorSets(m_Device, &allocInfo, &descriptorSet);
+
+    // The pool is exhausted, retire it until the next reset and retry once with a new pool that fits the set
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+    {
+        m_FullPools.push_back(m_CurrentPool);
+        m_CurrentPool = GrabPool(counts->second, false);
+
+        allocInfo.descriptorPool = m_CurrentPool;
+        result = vkAllocateDescriptorSets(m_Device, &allocInfo, &descriptorSet);
+    }
+
+    CheckForError(result != VK_SUCCESS, "Failed to allocate descriptor set!")
+
+    m_AllocatedSets++;
+    return descriptorSet;
+}
+
+void DescriptorAllocator::Reset()
+{
+    // Usage spilled over several pools, replace them with a single pool that fits the whole cycle next time
+    if (!m_FullPools.empty())
+    {
+        for (VkDescriptorPool pool : m_FullPools)
+            vkDestroyDescriptorPool(m_Device, pool, nullptr);
+        m_FullPools.clear();
+
+        if (m_CurrentPool != VK_NULL_HANDLE)
+            vkDestroyDescriptorPool(m_Device, m_CurrentPool, nullptr);
+        m_CurrentPool = VK_NULL_HANDLE;
+
+        for (VkDescriptorPool pool : m_FreePools)
+            vkDestroyDescriptorPool(m_Device, pool, nullptr);
+        m_FreePools.clear();
+
+        m_SetsPerPool = std::min(std::max(m_SetsPerPool, m_AllocatedSets + m_AllocatedSets / 2), MAX_SETS_PER_POOL);
+    }
+    else if (m_CurrentPool != VK_NULL_HANDLE)
+    {
+        vkResetDescriptorPool(m_Device, m_CurrentPool, 0);
+        m_FreePools.push_back(m_CurrentPool);
+        m_CurrentPool = VK_NULL_HANDLE;
+    }
+
+    m_AllocatedSets = 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <vector>
+#include <array>
+#include <stdint.h>
+
+// VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT is the last core descriptor type
+const uint32_t DESCRIPTOR_TYPE_COUNT = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT + 1;
+
+// Hands out descriptor sets from a list of pools. Pools are sized from the descriptors actually allocated,
+// a new one is added when the current pool runs out, and Reset recycles every pool at once instead of
+// freeing sets one by one. Use one allocator per frame in flight for sets that only live for a frame.
+class DescriptorAllocator
+{
+public:
+	void Init(VkDevice device, uint32_t initialSetsPerPool = 16);
+	void Destroy();
+
+	// The layout has to come from CreateSetLayout so the allocator knows which descriptors a set needs
+	VkDescriptorSet Allocate(VkDescriptorSetLayout layout);
+
+	// Every set allocated since the last reset becomes invalid, only call once the GPU is done with them
+	void Reset();
+
+	uint32_t GetPoolCount() const { return static_cast<uint32_t>(m_FullPools.size() + m_FreePools.size()) + (m_CurrentPool != VK_NULL_HANDLE ? 1 : 0); }
+	uint32_t GetAllocatedSetCount() const { return m_AllocatedSets; }
+
+	// Creates the layout and remembers its descriptor counts for pool sizing
+	static VkDescriptorSetLayout CreateSetLayout(VkDevice device, const VkDescriptorSetLayoutCreateInfo& createInfo);
+	static void DestroySetLayout(VkDevice device, VkDescriptorSetLayout layout);
+
+private:
+	VkDescriptorPool CreatePool(uint32_t setCount, const std::array<uint32_t, DESCRIPTOR_TYPE_COUNT>& minimumCounts);
+	VkDescriptorPool GrabPool(const std::array<uint32_t, DESCRIPTOR_TYPE_COUNT>& minimumCounts, bool reuse);
+
+private:
+	VkDevice m_Device = VK_NULL_HANDLE;
+
+	VkDescriptorPool m_CurrentPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorPool> m_FullPools;
+	std::vector<VkDescriptorPool> m_FreePools;
+
+	uint32_t m_SetsPerPool = 0;
+
+	// Sets allocated since the last reset, a cycle that needed several pools gets one pool of this size next time
+	uint32_t m_AllocatedSets = 0;
+
+	// Usage over the allocator's lifetime, gives the descriptor mix per set for new pools
+	uint64_t m_TotalSets = 0;
+	std::array<uint64_t, DESCRIPTOR_TYPE_COUNT> m_TotalDescriptors{};
+};
@@ -0,0 +1,231 @@
+#include "EntityRegistry.h"
+#include "Core.h"
+
+#include <cstring>
+#include <new>
+
+namespace
+{
+    const uint32_t COMPONENT_SIZES[ComponentTypeCount] = { sizeof(Transform), sizeof(MeshRef), sizeof(MaterialRef), sizeof(Bounds) };
+
+    // Arrays start on 16 byte boundaries so the vector types inside the components stay aligned
+    const uint32_t COMPONENT_ALIGNMENT = 16;
+
+    uint32_t AlignUp(uint32_t value, uint32_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    void ConstructComponent(ComponentType type, void* destination)
+    {
+        switch (type)
+        {
+        case ComponentTransform: new (destination) Transform(); break;
+        case ComponentMesh: new (destination) MeshRef(); break;
+        case ComponentMaterial: new (destination) MaterialRef(); break;
+        case ComponentBounds: new (destination) Bounds(); break;
+        default: break;
+        }
+    }
+}
+
+EntityRegistry::EntityRegistry()
+{
+}
+
+EntityRegistry::~EntityRegistry()
+{
+}
+
+Entity EntityRegistry::CreateEntity(ComponentMask mask)
+{
+    Entity entity;
+
+    if (!m_FreeEntities.empty())
+    {
+        entity = m_FreeEntities.back();
+        m_FreeEntities.pop_back();
+    }
+    else
+    {
+        entity = static_cast<Entity>(m_Records.size());
+        m_Records.emplace_back();
+    }
+
+    AllocateRow(GetOrCreateArchetype(mask), entity, m_Records[entity]);
+    m_EntityCount++;
+    m_StructureVersion++;
+
+    return entity;
+}
+
+void EntityRegistry::Destroy(Entity entity)
+{
+    EntityRecord& record = m_Records[entity];
+    CheckForError(record.archetype == UINT32_MAX, "Entity was already destroyed!")
+
+    FreeRow(record);
+    record = EntityRecord();
+
+    m_FreeEntities.push_back(entity);
+    m_EntityCount--;
+    m_StructureVersion++;
+}
+
+void EntityRegistry::Clear()
+{
+    // Archetypes and their layouts stay, so refilling the registry does not rebuild them
+    for (const std::unique_ptr<Archetype>& archetype : m_Archetypes)
+    {
+        archetype->chunks.clear();
+        archetype->entityCount = 0;
+    }
+
+    m_Records.clear();
+    m_FreeEntities.clear();
+    m_EntityCount = 0;
+    m_StructureVersion++;
+}
+
+uint32_t EntityRegistry::GetOrCreateArchetype(ComponentMask mask)
+{
+    for (uint32_t i = 0; i < m_Archetypes.size(); i++)
+    {
+        if (m_Archetypes[i]->mask == mask)
+            return i;
+    }
+
+    auto archetype = std::make_unique<Archetype>();
+    archetype->mask = mask;
+
+    uint32_t rowBytes = sizeof(Entity);
+    for (uint32_t type = 0; type < ComponentTypeCount; type++)
+    {
+        if (mask & (1u << type))
+            rowBytes += COMPONENT_SIZES[type];
+    }
+
+    // Leave room for the padding in front of every array, then lay the arrays out back to back
+    uint32_t capacity = (ENTITY_CHUNK_BYTES - COMPONENT_ALIGNMENT * ComponentTypeCount) / rowBytes;
+
+    uint32_t offset = AlignUp(sizeof(Entity) * capacity, COMPONENT_ALIGNMENT);
+    for (uint32_t type = 0; type < ComponentTypeCount; type++)
+    {
+        if ((mask & (1u << type)) == 0)
+            continue;
+
+        archetype->offsets[type] = offset;
+        offset = AlignUp(offset + COMPONENT_SIZES[type] * capacity, COMPONENT_ALIGNMENT);
+    }
+
+    CheckForError(offset > ENTITY_CHUNK_BYTES, "Archetype does not fit in a chunk!")
+    archetype->capacity = capacity;
+
+    m_Archetypes.push_back(std::move(archetype));
+    return static_cast<uint32_t>(m_Archetypes.size() - 1);
+}
+
+ComponentMask EntityRegistry::GetMask(Entity entity) const
+{
+    const EntityRecord& record = m_Records[entity];
+    return record.archetype != UINT32_MAX ? m_Archetypes[record.archetype]->mask : 0;
+}
+
+void* EntityRegistry::GetComponent(Entity entity, ComponentType type)
+{
+    const EntityRecord& record = m_Records[entity];
+    Archetype& archetype = *m_Archetypes[record.archetype];
+
+    if ((archetype.mask & (1u << type)) == 0)
+        return nullptr;
+
+    return archetype.chunks[record.chunk]->data + archetype.offsets[type] + COMPONENT_SIZES[type] * record.row;
+}
+
+void EntityRegistry::AllocateRow(uint32_t archetypeIndex, Entity entity, EntityRecord& record)
+{
+    Archetype& archetype = *m_Archetypes[archetypeIndex];
+
+    if (archetype.chunks.empty() || archetype.chunks.back()->count == archetype.capacity)
+        archetype.chunks.push_back(std::make_unique<Chunk>());
+
+    Chunk& chunk = *archetype.chunks.back();
+    uint32_t row = chunk.count++;
+
+    reinterpret_cast<Entity*>(chunk.data)[row] = entity;
+    for (uint32_t type = 0; type < ComponentTypeCount; type++)
+    {
+        if (archetype.mask & (1u << type))
+            ConstructComponent(static_cast<ComponentType>(type), chunk.data + archetype.offsets[type] + COMPONENT_SIZES[type] * row);
+    }
+
+    record.archetype = archetypeIndex;
+    record.chunk = static_cast<uint32_t>(archetype.chunks.size() - 1);
+    record.row = row;
+    archetype.entityCount++;
+}
+
+void EntityRegistry::FreeRow(const EntityRecord& record)
+{
+    Archetype& archetype = *m_Archetypes[record.archetype];
+    Chunk& lastChunk = *archetype.chunks.back();
+    uint32_t lastRow = lastChunk.count - 1;
+    uint32_t lastChunkIndex = static_cast<uint32_t>(archetype.chunks.size() - 1);
+
+    // Swap-remove against the very last row keeps every chunk except the last one full
+    if (record.chunk != lastChunkIndex || record.row != lastRow)
+    {
+        Chunk& chunk = *archetype.chunks[record.chunk];
+        Entity moved = reinterpret_cast<Entity*>(lastChunk.data)[lastRow];
+
+        reinterpret_cast<Entity*>(chunk.data)[record.row] = moved;
+        for (uint32_t type = 0; type < ComponentTypeCount; type++)
+        {
+            if ((archetype.mask & (1u << type)) == 0)
+                continue;
+
+            uint32_t size = COMPONENT_SIZES[type];
+            memcpy(chunk.data + archetype.offsets[type] + size * record.row, lastChunk.data + archetype.offsets[type] + size * lastRow, size);
+        }
+
+        m_Records[moved].chunk = record.chunk;
+        m_Records[moved].row = record.row;
+    }
+
+    if (--lastChunk.count == 0)
+        archetype.chunks.pop_back();
+
+    archetype.entityCount--;
+}
+
+void EntityRegistry::ChangeArchetype(Entity entity, ComponentMask mask)
+{
+    EntityRecord oldRecord = m_Records[entity];
+    Archetype& oldArchetype = *m_Archetypes[oldRecord.archetype];
+
+    if (oldArchetype.mask == mask)
+        return;
+
+    // Creating the archetype may grow m_Archetypes, so it is looked up again below
+    uint32_t newArchetypeIndex = GetOrCreateArchetype(mask);
+    EntityRecord newRecord;
+    AllocateRow(newArchetypeIndex, entity, newRecord);
+
+    const Archetype& source = *m_Archetypes[oldRecord.archetype];
+    const Archetype& destination = *m_Archetypes[newArchetypeIndex];
+    ComponentMask shared = source.mask & destination.mask;
+
+    for (uint32_t type = 0; type < ComponentTypeCount; type++)
+    {
+        if ((shared & (1u << type)) == 0)
+            continue;
+
+        uint32_t size = COMPONENT_SIZES[type];
+        memcpy(destination.chunks[newRecord.chunk]->data + destination.offsets[type] + size * newRecord.row,
+            source.chunks[oldRecord.chunk]->data + source.offsets[type] + size * oldRecord.row, size);
+    }
+
+    FreeRow(oldRecord);
+    m_Records[entity] = newRecord;
+    m_StructureVersion++;
+}
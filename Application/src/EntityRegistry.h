@@ -0,0 +1,152 @@
+#pragma once
+
+#include "Components.h"
+
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+using Entity = uint32_t;
+const Entity INVALID_ENTITY = UINT32_MAX;
+
+// Size of one block of entities, every archetype splits its chunk into one array per component
+const uint32_t ENTITY_CHUNK_BYTES = 16 * 1024;
+
+// Entities are grouped by the exact set of components they have (their archetype). Each archetype stores its
+// entities in fixed-size chunks holding one tightly packed array per component, so a query walks contiguous
+// memory chunk by chunk instead of following per-entity pointers.
+class EntityRegistry
+{
+public:
+	EntityRegistry();
+	~EntityRegistry();
+
+	template<typename... Ts>
+	Entity Create(const Ts&... components)
+	{
+		Entity entity = CreateEntity(GetComponentMask<Ts...>());
+		(Set(entity, components), ...);
+		return entity;
+	}
+
+	void Destroy(Entity entity);
+	void Clear();
+
+	template<typename T>
+	bool Has(Entity entity) const { return (GetMask(entity) & GetComponentMask<T>()) != 0; }
+
+	// The pointer is invalidated by any create, destroy, add or remove
+	template<typename T>
+	T* Get(Entity entity) { return static_cast<T*>(GetComponent(entity, ComponentTraits<T>::type)); }
+
+	template<typename T>
+	void Set(Entity entity, const T& component) { *Get<T>(entity) = component; }
+
+	// Moves the entity to the archetype with/without T
+	template<typename T>
+	void Add(Entity entity, const T& component)
+	{
+		ChangeArchetype(entity, GetMask(entity) | GetComponentMask<T>());
+		Set(entity, component);
+	}
+
+	template<typename T>
+	void Remove(Entity entity) { ChangeArchetype(entity, GetMask(entity) & ~GetComponentMask<T>()); }
+
+	// Calls function(count, entities, Ts*...) once per chunk of every archetype that has all of Ts,
+	// the arrays are 'count' long and meant to be walked with a plain loop
+	template<typename... Ts, typename Function>
+	void ForEachChunk(Function&& function)
+	{
+		ComponentMask mask = GetComponentMask<Ts...>();
+
+		for (const std::unique_ptr<Archetype>& archetype : m_Archetypes)
+		{
+			if ((archetype->mask & mask) != mask)
+				continue;
+
+			for (const std::unique_ptr<Chunk>& chunk : archetype->chunks)
+			{
+				if (chunk->count == 0)
+					continue;
+
+				function(chunk->count, reinterpret_cast<const Entity*>(chunk->data),
+					reinterpret_cast<Ts*>(chunk->data + archetype->offsets[ComponentTraits<Ts>::type])...);
+			}
+		}
+	}
+
+	// Per entity convenience over ForEachChunk, function(entity, Ts&...)
+	template<typename... Ts, typename Function>
+	void ForEach(Function&& function)
+	{
+		ForEachChunk<Ts...>([&function](uint32_t count, const Entity* entities, Ts*... components)
+		{
+			for (uint32_t i = 0; i < count; i++)
+				function(entities[i], components[i]...);
+		});
+	}
+
+	template<typename... Ts>
+	uint32_t Count() const
+	{
+		ComponentMask mask = GetComponentMask<Ts...>();
+		uint32_t count = 0;
+
+		for (const std::unique_ptr<Archetype>& archetype : m_Archetypes)
+		{
+			if ((archetype->mask & mask) == mask)
+				count += archetype->entityCount;
+		}
+
+		return count;
+	}
+
+	uint32_t GetEntityCount() const { return m_EntityCount; }
+	// Changes whenever entities are created, destroyed or change archetype, i.e. whenever query order may change
+	uint64_t GetStructureVersion() const { return m_StructureVersion; }
+	uint32_t GetArchetypeCount() const { return static_cast<uint32_t>(m_Archetypes.size()); }
+
+private:
+	struct alignas(64) Chunk
+	{
+		uint8_t data[ENTITY_CHUNK_BYTES];
+		uint32_t count = 0;
+	};
+
+	struct Archetype
+	{
+		ComponentMask mask = 0;
+		// Byte offset of each component array inside a chunk, the entity array sits at offset 0
+		uint32_t offsets[ComponentTypeCount] = {};
+		uint32_t capacity = 0;
+		uint32_t entityCount = 0;
+		// Every chunk but the last is full, destroy fills holes from the end
+		std::vector<std::unique_ptr<Chunk>> chunks;
+	};
+
+	struct EntityRecord
+	{
+		uint32_t archetype = UINT32_MAX;
+		uint32_t chunk = 0;
+		uint32_t row = 0;
+	};
+
+	Entity CreateEntity(ComponentMask mask);
+	uint32_t GetOrCreateArchetype(ComponentMask mask);
+	ComponentMask GetMask(Entity entity) const;
+	void* GetComponent(Entity entity, ComponentType type);
+
+	// Appends a default-initialized row, returns where it went
+	void AllocateRow(uint32_t archetypeIndex, Entity entity, EntityRecord& record);
+	// Fills the row from the archetype's last row and updates the moved entity
+	void FreeRow(const EntityRecord& record);
+	void ChangeArchetype(Entity entity, ComponentMask mask);
+
+private:
+	std::vector<std::unique_ptr<Archetype>> m_Archetypes;
+	std::vector<EntityRecord> m_Records;
+	std::vector<Entity> m_FreeEntities;
+	uint32_t m_EntityCount = 0;
+	uint64_t m_StructureVersion = 0;
+};
@@ -0,0 +1,18 @@
+#include "FrameSnapshot.h"
+
+void SnapshotExchange::Publish()
+{
+    uint32_t previous = m_Shared.exchange(m_WriteIndex | FRESH_BIT, std::memory_order_acq_rel);
+    m_WriteIndex = previous & INDEX_MASK;
+}
+
+const FrameSnapshot& SnapshotExchange::AcquireLatest()
+{
+    if (m_Shared.load(std::memory_order_acquire) & FRESH_BIT)
+    {
+        uint32_t previous = m_Shared.exchange(m_ReadIndex, std::memory_order_acq_rel);
+        m_ReadIndex = previous & INDEX_MASK;
+    }
+
+    return m_Snapshots[m_ReadIndex];
+}
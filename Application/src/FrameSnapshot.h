@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Components.h"
+
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+
+// Everything the render thread needs from one simulation step. Once published it is never written again
+// until the render thread has handed it back, so reading it needs no locks.
+struct FrameSnapshot
+{
+	uint64_t simulationFrame = 0;
+	// FrameTiming time of the step, the renderer interpolates from the previous step towards it
+	double simulationTime = 0.0;
+
+	// Renderable entities as parallel arrays, copied chunk by chunk out of the entity registry
+	std::vector<Transform> transforms;
+	std::vector<MeshRef> meshes;
+	std::vector<MaterialRef> materials;
+	std::vector<Bounds> bounds;
+	// Transforms of the previous step in the same order, equal to 'transforms' after entities were added or removed
+	std::vector<Transform> previousTransforms;
+	// False when the step left every transform where it was, nothing needs redrawing for it
+	bool changed = true;
+
+	uint32_t GetRenderableCount() const { return static_cast<uint32_t>(transforms.size()); }
+};
+
+// Triple buffer between one producer (simulation) and one consumer (render). The producer always has a slot to
+// write, the consumer always has the newest complete snapshot to read, and neither waits for the other.
+class SnapshotExchange
+{
+public:
+	// Producer side, the returned slot keeps whatever was last written to it, callers overwrite all of it
+	FrameSnapshot& GetWriteSnapshot() { return m_Snapshots[m_WriteIndex]; }
+	void Publish();
+
+	// Consumer side, swaps in the newest snapshot if there is one, otherwise keeps returning the current one
+	const FrameSnapshot& AcquireLatest();
+
+private:
+	static const uint32_t INDEX_MASK = 0x3;
+	static const uint32_t FRESH_BIT = 0x4;
+
+	FrameSnapshot m_Snapshots[3];
+	uint32_t m_WriteIndex = 0;
+	uint32_t m_ReadIndex = 1;
+	// Index of the slot in the middle, plus FRESH_BIT while the consumer has not picked it up
+	std::atomic<uint32_t> m_Shared{ 2 };
+};
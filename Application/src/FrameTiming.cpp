@@ -0,0 +1,259 @@
+#include "FrameTiming.h"
+
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Running estimate of how long a 1 ms sleep really takes on this thread, the OS scheduler decides
+    // the overshoot and it differs between threads, so every thread keeps its own
+    struct SleepEstimator
+    {
+        double estimate = 0.005;
+        double mean = 0.005;
+        double m2 = 0.0;
+        uint64_t count = 1;
+
+        void Add(double observed)
+        {
+            // Welford's algorithm, the count is capped so the estimate follows changes in system load
+            count = std::min<uint64_t>(count + 1, 64);
+            double delta = observed - mean;
+            mean += delta / count;
+            m2 += delta * (observed - mean);
+            m2 = std::max(m2, 0.0);
+
+            estimate = mean + std::sqrt(m2 / (count - 1));
+        }
+    };
+
+    thread_local SleepEstimator t_SleepEstimator;
+}
+
+struct FrameTimingData
+{
+    Clock::time_point start;
+    double fixedTimestep;
+    double simulationTime = 0.0;
+
+    double targetFrameRate = 0.0;
+    double nextFrameTime = 0.0;
+    double lastFrameEnd = 0.0;
+
+    float history[FRAME_HISTORY_SIZE] = {};
+    uint32_t historyOffset = 0;
+    uint32_t historyCount = 0;
+
+    // Stage times of the frame in progress, moved into the history by EndFrame
+    double currentStages[FRAME_STAGE_COUNT] = {};
+    float stageHistory[FRAME_STAGE_COUNT][FRAME_HISTORY_SIZE] = {};
+};
+
+static FrameTimingData* s_FrameTimingData = nullptr;
+
+void FrameTiming::Initialize(double fixedTimestep)
+{
+    s_FrameTimingData = new FrameTimingData();
+    s_FrameTimingData->start = Clock::now();
+    s_FrameTimingData->fixedTimestep = fixedTimestep;
+
+#ifdef _WIN32
+    // The default 15.6 ms timer tick makes every sleep useless for frame pacing
+    timeBeginPeriod(1);
+#endif
+}
+
+void FrameTiming::Shutdown()
+{
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+
+    delete s_FrameTimingData;
+    s_FrameTimingData = nullptr;
+}
+
+double FrameTiming::Now()
+{
+    return std::chrono::duration<double>(Clock::now() - s_FrameTimingData->start).count();
+}
+
+void FrameTiming::WaitUntil(double time)
+{
+    SleepEstimator& estimator = t_SleepEstimator;
+
+    while (time - Now() > estimator.estimate)
+    {
+        double start = Now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        estimator.Add(Now() - start);
+    }
+
+    // The last stretch is shorter than a sleep could be trusted with
+    while (Now() < time)
+        std::this_thread::yield();
+}
+
+double FrameTiming::GetFixedTimestep()
+{
+    return s_FrameTimingData->fixedTimestep;
+}
+
+double FrameTiming::GetSimulationTime()
+{
+    return s_FrameTimingData->simulationTime;
+}
+
+void FrameTiming::SetSimulationTime(double time)
+{
+    s_FrameTimingData->simulationTime = time;
+}
+
+void FrameTiming::SetTargetFrameRate(double framesPerSecond)
+{
+    s_FrameTimingData->targetFrameRate = std::max(framesPerSecond, 0.0);
+    s_FrameTimingData->nextFrameTime = 0.0;
+}
+
+double FrameTiming::GetTargetFrameRate()
+{
+    return s_FrameTimingData->targetFrameRate;
+}
+
+void FrameTiming::EndFrame()
+{
+    FrameTimingData& data = *s_FrameTimingData;
+
+    if (data.targetFrameRate > 0.0)
+    {
+        double interval = 1.0 / data.targetFrameRate;
+        double now = Now();
+
+        // Slots are spaced from the previous slot rather than from now, so waits do not accumulate drift.
+        // A frame that missed its slot by more than a whole interval starts a new schedule instead of bursting.
+        if (data.nextFrameTime == 0.0 || now - data.nextFrameTime > interval)
+            data.nextFrameTime = now;
+        else
+            WaitUntil(data.nextFrameTime);
+
+        data.nextFrameTime += interval;
+    }
+
+    double frameEnd = Now();
+    if (data.lastFrameEnd > 0.0)
+    {
+        uint32_t slot = (data.historyOffset + data.historyCount) % FRAME_HISTORY_SIZE;
+        data.history[slot] = static_cast<float>((frameEnd - data.lastFrameEnd) * 1000.0);
+        for (uint32_t stage = 0; stage < FRAME_STAGE_COUNT; stage++)
+            data.stageHistory[stage][slot] = static_cast<float>(data.currentStages[stage] * 1000.0);
+
+        if (data.historyCount < FRAME_HISTORY_SIZE)
+            data.historyCount++;
+        else
+            data.historyOffset = (data.historyOffset + 1) % FRAME_HISTORY_SIZE;
+    }
+    data.lastFrameEnd = frameEnd;
+
+    for (double& stage : data.currentStages)
+        stage = 0.0;
+}
+
+FramePacingStats FrameTiming::GetStats()
+{
+    const FrameTimingData& data = *s_FrameTimingData;
+    FramePacingStats stats{};
+    stats.frameCount = data.historyCount;
+
+    if (data.historyCount == 0)
+        return stats;
+
+    float intervals[FRAME_HISTORY_SIZE];
+    double sum = 0.0;
+
+    for (uint32_t i = 0; i < data.historyCount; i++)
+    {
+        intervals[i] = data.history[(data.historyOffset + i) % FRAME_HISTORY_SIZE];
+        sum += intervals[i];
+    }
+
+    double average = sum / data.historyCount;
+    double variance = 0.0;
+    for (uint32_t i = 0; i < data.historyCount; i++)
+        variance += (intervals[i] - average) * (intervals[i] - average);
+
+    std::sort(intervals, intervals + data.historyCount);
+
+    stats.averageMs = static_cast<float>(average);
+    stats.minMs = intervals[0];
+    stats.maxMs = intervals[data.historyCount - 1];
+    stats.percentile99Ms = intervals[std::min(data.historyCount - 1, static_cast<uint32_t>(data.historyCount * 0.99f))];
+    stats.jitterMs = static_cast<float>(std::sqrt(variance / data.historyCount));
+
+    return stats;
+}
+
+const float* FrameTiming::GetHistory(uint32_t& offset)
+{
+    offset = s_FrameTimingData->historyOffset;
+    return s_FrameTimingData->history;
+}
+
+void FrameTiming::AddStageTime(FrameStage stage, double seconds)
+{
+    s_FrameTimingData->currentStages[static_cast<uint32_t>(stage)] += seconds;
+}
+
+const char* FrameTiming::GetStageName(FrameStage stage)
+{
+    switch (stage)
+    {
+    case FrameStage::FenceWait:   return "Fence wait";
+    case FrameStage::AcquireWait: return "Acquire wait";
+    case FrameStage::Record:      return "Record";
+    case FrameStage::Submit:      return "Submit";
+    case FrameStage::Present:     return "Present";
+    default:                      return "Unknown";
+    }
+}
+
+const float* FrameTiming::GetStageHistory(FrameStage stage, uint32_t& offset)
+{
+    offset = s_FrameTimingData->historyOffset;
+    return s_FrameTimingData->stageHistory[static_cast<uint32_t>(stage)];
+}
+
+bool FrameTiming::WriteHistoryCsv(const std::string& path)
+{
+    std::ofstream file(path);
+    if (!file)
+        return false;
+
+    const FrameTimingData& data = *s_FrameTimingData;
+
+    file << "frame,interval_ms";
+    for (uint32_t stage = 0; stage < FRAME_STAGE_COUNT; stage++)
+        file << ',' << GetStageName(static_cast<FrameStage>(stage));
+    file << '\n';
+
+    for (uint32_t i = 0; i < data.historyCount; i++)
+    {
+        uint32_t slot = (data.historyOffset + i) % FRAME_HISTORY_SIZE;
+        file << i << ',' << data.history[slot];
+        for (uint32_t stage = 0; stage < FRAME_STAGE_COUNT; stage++)
+            file << ',' << data.stageHistory[stage][slot];
+        file << '\n';
+    }
+
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+// Frame interval statistics over the last FRAME_HISTORY_SIZE presented frames, in milliseconds
+struct FramePacingStats
+{
+	uint32_t frameCount;
+	float averageMs;
+	float minMs;
+	float maxMs;
+	float percentile99Ms;
+	// Standard deviation of the interval, 0 means perfectly even delivery
+	float jitterMs;
+};
+
+const uint32_t FRAME_HISTORY_SIZE = 256;
+
+// Parts of a frame the renderer times, kept per frame next to the frame interval
+enum class FrameStage : uint32_t
+{
+	FenceWait,	// CPU waiting for the GPU to finish an earlier frame, large when GPU-bound
+	AcquireWait,	// Blocked in vkAcquireNextImageKHR, large when present-bound
+	Record,		// CPU work from acquire to submit, large when CPU-bound
+	Submit,
+	Present,
+	Count
+};
+
+const uint32_t FRAME_STAGE_COUNT = static_cast<uint32_t>(FrameStage::Count);
+
+// Clock, fixed simulation step and frame rate cap shared by the application loop, layers and the renderer.
+// All times are seconds on one steady clock that starts at Initialize.
+class FrameTiming
+{
+public:
+	static void Initialize(double fixedTimestep = 1.0 / 60.0);
+	static void Shutdown();
+
+	static double Now();
+
+	// Sleeps while the remaining time is longer than a sleep is likely to overshoot, then spins
+	static void WaitUntil(double time);
+
+	static double GetFixedTimestep();
+	// Logical time of the simulation step being computed, steps are exactly one fixed timestep apart
+	static double GetSimulationTime();
+	static void SetSimulationTime(double time);
+
+	// 0 leaves the frame rate uncapped
+	static void SetTargetFrameRate(double framesPerSecond);
+	static double GetTargetFrameRate();
+
+	// Called once per rendered frame, waits for the next slot of the cap and records the frame interval
+	static void EndFrame();
+
+	static FramePacingStats GetStats();
+	// Ring buffer of frame intervals, 'offset' is the index of the oldest entry
+	static const float* GetHistory(uint32_t& offset);
+
+	// Adds to the stage's time in the current frame, stages may be entered more than once per frame
+	static void AddStageTime(FrameStage stage, double seconds);
+	static const char* GetStageName(FrameStage stage);
+	// Stage times in milliseconds, same ring layout and offset as GetHistory
+	static const float* GetStageHistory(FrameStage stage, uint32_t& offset);
+	// Writes the history oldest first, one row per frame with the interval and every stage, false if the file could not be opened
+	static bool WriteHistoryCsv(const std::string& path);
+};
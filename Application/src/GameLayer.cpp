@@ -1,5 +1,6 @@
 #include "GameLayer.h"
 #include "VulkanRenderer.h"
+#include "FrameTiming.h"
 
 GameLayer::GameLayer()
 	: Layer()
@@ -18,6 +19,15 @@ void GameLayer::OnAttach()
 }
 
 void GameLayer::OnUpdate()
+{
+	VulkanRenderer::BeginSimulationStep();
+
+	// Game logic goes here and advances by exactly FrameTiming::GetFixedTimestep(), then the renderable state
+	// of this step is handed to the render thread
+	VulkanRenderer::PublishSnapshot(++m_SimulationFrame, FrameTiming::GetSimulationTime());
+}
+
+void GameLayer::OnRender()
 {
 	VulkanRenderer::OnUpdate();
 }
\ No newline at end of file
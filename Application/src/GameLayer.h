@@ -1,6 +1,8 @@
 #pragma once
 #include "Layer.h"
 
+#include <stdint.h>
+
 class GameLayer : public Layer
 {
 public:
@@ -9,6 +11,8 @@ public:
 
 	void OnAttach();
 	void OnUpdate();
+	void OnRender();
 
 private:
+	uint64_t m_SimulationFrame = 0;
 };
\ No newline at end of file
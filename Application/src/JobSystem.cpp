@@ -0,0 +1,454 @@
+#include "JobSystem.h"
+#include "Core.h"
+
+#include <thread>
+#include <deque>
+#include <condition_variable>
+#include <chrono>
+#include <cmath>
+#include <memory>
+
+namespace
+{
+    struct Job
+    {
+        JobFunction function;
+        JobCounter* counter;
+        uint32_t group;
+    };
+
+    // Owner pushes and pops at the back, thieves take from the front so they get the oldest and usually largest work
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    // Spins this many failed steal rounds before a worker goes to sleep
+    const uint32_t IDLE_SPIN_COUNT = 64;
+
+    // Threads besides the one that called Initialize that can get a group of their own
+    const uint32_t MAX_ATTACHED_THREADS = 4;
+
+    // PopJob group filter of the background workers
+    const uint32_t ANY_GROUP = UINT32_MAX;
+
+    thread_local uint32_t t_ThreadIndex = UINT32_MAX;
+    // Deque of the calling thread within every group, workers first and attached threads after them
+    thread_local uint32_t t_QueueSlot = UINT32_MAX;
+    // Group new jobs go to, the thread's own while it submits, the running job's while a worker executes it
+    thread_local uint32_t t_Group = 0;
+}
+
+struct JobSystemData
+{
+    // groups[group][slot], group 0 belongs to the thread that called Initialize and group i to the i-th attached
+    // thread. Allocated up front so attaching never moves a deque under a running thief.
+    std::vector<std::vector<std::unique_ptr<WorkerQueue>>> groups;
+    std::vector<std::thread> workers;
+    uint32_t workerCount = 0;
+    std::atomic<uint32_t> attachedThreads{ 0 };
+
+    // Sleeping workers wait here until a job is queued or the system shuts down
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::atomic<uint32_t> queuedJobs{ 0 };
+    std::atomic<bool> running{ false };
+
+    // Threads the scheduler does not own spread their submissions over the queues
+    std::atomic<uint32_t> nextExternalQueue{ 0 };
+};
+
+static JobSystemData* s_JobSystemData = nullptr;
+
+static uint32_t GetQueueSlotCount()
+{
+    return s_JobSystemData->workerCount + s_JobSystemData->attachedThreads.load(std::memory_order_acquire);
+}
+
+static void PushJob(Job job)
+{
+    uint32_t slotCount = GetQueueSlotCount();
+    uint32_t slot = t_QueueSlot < slotCount ? t_QueueSlot : s_JobSystemData->nextExternalQueue.fetch_add(1) % s_JobSystemData->workerCount;
+
+    {
+        WorkerQueue& queue = *s_JobSystemData->groups[job.group][slot];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+
+    s_JobSystemData->queuedJobs.fetch_add(1, std::memory_order_release);
+
+    // Taking the lock orders the notify after a sleeper's predicate check, so the wake-up cannot be lost
+    {
+        std::lock_guard<std::mutex> lock(s_JobSystemData->sleepMutex);
+    }
+    s_JobSystemData->sleepCondition.notify_one();
+}
+
+// 'group' is ANY_GROUP for the background workers, a waiting thread only takes jobs of its own group
+static bool PopJob(Job& job, uint32_t group)
+{
+    uint32_t slotCount = GetQueueSlotCount();
+    uint32_t firstGroup = group == ANY_GROUP ? 0 : group;
+    uint32_t lastGroup = group == ANY_GROUP ? 1 + s_JobSystemData->attachedThreads.load(std::memory_order_acquire) : group + 1;
+
+    // Own queue first, newest job, its data is most likely still in cache
+    if (t_QueueSlot < slotCount)
+    {
+        for (uint32_t g = firstGroup; g < lastGroup; g++)
+        {
+            WorkerQueue& queue = *s_JobSystemData->groups[g][t_QueueSlot];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+
+            if (!queue.jobs.empty())
+            {
+                job = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+                s_JobSystemData->queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+
+    // Steal the oldest job of the next non-empty queue, starting after ourselves so thieves spread out
+    uint32_t self = t_QueueSlot < slotCount ? t_QueueSlot : 0;
+    for (uint32_t g = firstGroup; g < lastGroup; g++)
+    {
+        for (uint32_t offset = 1; offset <= slotCount; offset++)
+        {
+            uint32_t slot = (self + offset) % slotCount;
+            if (slot == t_QueueSlot)
+                continue;
+
+            WorkerQueue& queue = *s_JobSystemData->groups[g][slot];
+            std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);
+
+            if (lock.owns_lock() && !queue.jobs.empty())
+            {
+                job = std::move(queue.jobs.front());
+                queue.jobs.pop_front();
+                s_JobSystemData->queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static void FinishJob(JobCounter* counter)
+{
+    if (counter == nullptr)
+        return;
+
+    // The lock makes the final decrement and the hand-off of the continuations one step for RunAfter
+    std::vector<JobCounter::Continuation> continuations;
+    {
+        std::lock_guard<std::mutex> lock(counter->mutex);
+        if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            continuations.swap(counter->continuations);
+    }
+
+    for (JobCounter::Continuation& continuation : continuations)
+        PushJob({ std::move(continuation.function), continuation.counter, continuation.group });
+}
+
+static void ExecuteJob(Job& job)
+{
+    // Jobs queued from inside this one, and its waits, stay in its group
+    uint32_t previousGroup = t_Group;
+    t_Group = job.group;
+
+    job.function();
+    FinishJob(job.counter);
+
+    t_Group = previousGroup;
+}
+
+static void WorkerLoop(uint32_t threadIndex)
+{
+    t_ThreadIndex = threadIndex;
+    t_QueueSlot = threadIndex;
+    uint32_t idleRounds = 0;
+
+    while (s_JobSystemData->running.load(std::memory_order_acquire))
+    {
+        Job job;
+        if (PopJob(job, ANY_GROUP))
+        {
+            ExecuteJob(job);
+            idleRounds = 0;
+            continue;
+        }
+
+        if (++idleRounds < IDLE_SPIN_COUNT)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(s_JobSystemData->sleepMutex);
+        s_JobSystemData->sleepCondition.wait(lock, []()
+        {
+            return s_JobSystemData->queuedJobs.load(std::memory_order_acquire) > 0 || !s_JobSystemData->running.load(std::memory_order_acquire);
+        });
+        idleRounds = 0;
+    }
+}
+
+void JobSystem::Initialize(uint32_t threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    s_JobSystemData = new JobSystemData();
+    s_JobSystemData->running = true;
+    s_JobSystemData->workerCount = threadCount;
+
+    s_JobSystemData->groups.resize(1 + MAX_ATTACHED_THREADS);
+    for (auto& group : s_JobSystemData->groups)
+    {
+        for (uint32_t i = 0; i < threadCount + MAX_ATTACHED_THREADS; i++)
+            group.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    // The calling thread is worker 0, it only runs jobs while waiting
+    t_ThreadIndex = 0;
+    t_QueueSlot = 0;
+    t_Group = 0;
+    for (uint32_t i = 1; i < threadCount; i++)
+        s_JobSystemData->workers.emplace_back(WorkerLoop, i);
+
+    spdlog::info("Job system started with {} threads", threadCount);
+}
+
+void JobSystem::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(s_JobSystemData->sleepMutex);
+        s_JobSystemData->running = false;
+    }
+    s_JobSystemData->sleepCondition.notify_all();
+
+    for (std::thread& worker : s_JobSystemData->workers)
+        worker.join();
+
+    t_ThreadIndex = UINT32_MAX;
+    t_QueueSlot = UINT32_MAX;
+    delete s_JobSystemData;
+    s_JobSystemData = nullptr;
+}
+
+void JobSystem::AttachThread()
+{
+    // Slot and group are published by the increment, the deques behind them already exist
+    uint32_t attached = s_JobSystemData->attachedThreads.load(std::memory_order_relaxed);
+    do
+    {
+        CheckForError(attached >= MAX_ATTACHED_THREADS, "Too many threads attached to the job system!")
+    } while (!s_JobSystemData->attachedThreads.compare_exchange_weak(attached, attached + 1, std::memory_order_acq_rel));
+
+    t_QueueSlot = s_JobSystemData->workerCount + attached;
+    t_Group = 1 + attached;
+}
+
+void JobSystem::Run(JobFunction function, JobCounter* counter)
+{
+    if (counter != nullptr)
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+    PushJob({ std::move(function), counter, t_Group });
+}
+
+void JobSystem::RunAfter(JobCounter& dependency, JobFunction function, JobCounter* counter)
+{
+    if (counter != nullptr)
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock(dependency.mutex);
+        if (!dependency.IsDone())
+        {
+            dependency.continuations.push_back({ std::move(function), counter, t_Group });
+            return;
+        }
+    }
+
+    PushJob({ std::move(function), counter, t_Group });
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+    while (!counter.IsDone())
+    {
+        Job job;
+        if (PopJob(job, t_Group))
+            ExecuteJob(job);
+        else
+            std::this_thread::yield();
+    }
+
+    // The finishing thread may still be inside FinishJob, holding the counter's lock
+    std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t begin, uint32_t end)>& function)
+{
+    if (count == 0)
+        return;
+
+    if (batchSize == 0)
+        batchSize = std::max(1u, count / (GetThreadCount() * 4));
+
+    // A single batch is not worth a round trip through the queues
+    if (count <= batchSize)
+    {
+        function(0, count);
+        return;
+    }
+
+    JobCounter counter;
+    for (uint32_t begin = batchSize; begin < count; begin += batchSize)
+    {
+        uint32_t end = std::min(begin + batchSize, count);
+        Run([&function, begin, end]() { function(begin, end); }, &counter);
+    }
+
+    // The caller takes the first batch itself instead of idling
+    function(0, std::min(batchSize, count));
+    Wait(counter);
+}
+
+uint32_t JobSystem::GetThreadCount()
+{
+    return s_JobSystemData->workerCount;
+}
+
+uint32_t JobSystem::GetThreadIndex()
+{
+    return t_ThreadIndex;
+}
+
+void JobSystem::RunStressTest()
+{
+    using Clock = std::chrono::high_resolution_clock;
+    auto start = Clock::now();
+    bool passed = true;
+
+    // Many tiny jobs, some of them spawning more jobs on the same counter
+    {
+        const uint32_t jobCount = 100000;
+        std::atomic<uint32_t> executed{ 0 };
+        JobCounter counter;
+
+        for (uint32_t i = 0; i < jobCount; i++)
+        {
+            Run([&executed, &counter, i]()
+            {
+                executed.fetch_add(1, std::memory_order_relaxed);
+                if (i % 16 == 0)
+                    Run([&executed]() { executed.fetch_add(1, std::memory_order_relaxed); }, &counter);
+            }, &counter);
+        }
+
+        Wait(counter);
+        passed &= executed.load() == jobCount + jobCount / 16;
+    }
+
+    // Dependency chain, every stage has to see all jobs of the previous stage finished
+    {
+        const uint32_t stageCount = 64;
+        const uint32_t jobsPerStage = 64;
+        std::vector<std::unique_ptr<JobCounter>> stages;
+        std::vector<std::atomic<uint32_t>> completed(stageCount);
+        std::atomic<bool> ordered{ true };
+
+        for (uint32_t stage = 0; stage < stageCount; stage++)
+        {
+            stages.push_back(std::make_unique<JobCounter>());
+            completed[stage] = 0;
+
+            for (uint32_t i = 0; i < jobsPerStage; i++)
+            {
+                auto job = [&completed, &ordered, stage]()
+                {
+                    if (stage > 0 && completed[stage - 1].load() != jobsPerStage)
+                        ordered = false;
+                    completed[stage].fetch_add(1);
+                };
+
+                if (stage == 0)
+                    Run(job, stages[stage].get());
+                else
+                    RunAfter(*stages[stage - 1], job, stages[stage].get());
+            }
+        }
+
+        Wait(*stages.back());
+        passed &= ordered.load() && completed[stageCount - 1].load() == jobsPerStage;
+    }
+
+    // Every index covered exactly once, including the uneven last batch
+    {
+        const uint32_t count = 1000003;
+        std::vector<uint8_t> visits(count, 0);
+        ParallelFor(count, 0, [&visits](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; i++)
+                visits[i]++;
+        });
+
+        for (uint8_t visit : visits)
+            passed &= visit == 1;
+    }
+
+    double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    if (passed)
+        spdlog::info("Job system stress test passed in {:.1f} ms", milliseconds);
+    else
+        spdlog::error("Job system stress test failed!");
+}
+
+void JobSystem::RunBenchmark(uint32_t elementCount)
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    std::vector<float> values(elementCount);
+    for (uint32_t i = 0; i < elementCount; i++)
+        values[i] = static_cast<float>(i % 1024) * 0.001f;
+
+    auto memoryBound = [&values](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; i++)
+            values[i] = values[i] * 1.0001f + 0.5f;
+    };
+
+    auto computeBound = [&values](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            float value = values[i];
+            for (int iteration = 0; iteration < 32; iteration++)
+                value = std::sin(value) + std::sqrt(value * value + 1.0f);
+            values[i] = value * 0.001f;
+        }
+    };
+
+    auto measure = [](auto&& work)
+    {
+        auto start = Clock::now();
+        work();
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    double memorySingle = measure([&]() { memoryBound(0, elementCount); });
+    double memoryParallel = measure([&]() { ParallelFor(elementCount, 0, memoryBound); });
+    double computeSingle = measure([&]() { computeBound(0, elementCount); });
+    double computeParallel = measure([&]() { ParallelFor(elementCount, 0, computeBound); });
+
+    spdlog::info("Job system benchmark, {} elements on {} threads:", elementCount, GetThreadCount());
+    spdlog::info("  memory bound:  {:.2f} ms single, {:.2f} ms parallel ({:.1f}x)", memorySingle, memoryParallel, memorySingle / memoryParallel);
+    spdlog::info("  compute bound: {:.2f} ms single, {:.2f} ms parallel ({:.1f}x)", computeSingle, computeParallel, computeSingle / computeParallel);
+}
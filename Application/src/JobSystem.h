@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+using JobFunction = std::function<void()>;
+
+// Counts the unfinished jobs submitted with it. Jobs queued with RunAfter start once it reaches zero.
+// Must outlive every job that references it.
+struct JobCounter
+{
+	std::atomic<uint32_t> pending{ 0 };
+
+	bool IsDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+	// Owned by the scheduler
+	struct Continuation
+	{
+		JobFunction function;
+		JobCounter* counter;
+		uint32_t group;
+	};
+	std::mutex mutex;
+	std::vector<Continuation> continuations;
+};
+
+// Work-stealing scheduler. Each thread owns a deque and pops its newest job, idle threads steal the oldest job
+// of another deque. The thread that calls Initialize becomes worker 0 and runs jobs whenever it waits.
+// Jobs must not block on I/O, long blocking work belongs on its own thread.
+//
+// Jobs belong to the group of the thread that submitted them, jobs queued from inside a job join its group.
+// Background workers run every group, a waiting thread only runs its own, so a long job of one submitter never
+// stalls another submitter's wait.
+class JobSystem
+{
+public:
+	// 0 uses one thread per hardware thread, counting the calling thread
+	static void Initialize(uint32_t threadCount = 0);
+	static void Shutdown();
+
+	// Gives the calling thread a group of its own for the lifetime of the job system, call it before the thread
+	// submits anything. Threads that never attach submit into the group of the thread that called Initialize.
+	static void AttachThread();
+
+	static void Run(JobFunction function, JobCounter* counter = nullptr);
+	// Queues 'function' once 'dependency' has no pending jobs left
+	static void RunAfter(JobCounter& dependency, JobFunction function, JobCounter* counter = nullptr);
+
+	// Executes other jobs until the counter reaches zero
+	static void Wait(JobCounter& counter);
+
+	// Splits [0, count) into ranges of at most 'batchSize' and blocks until all of them ran,
+	// a batch size of 0 picks one that gives every thread a few ranges
+	static void ParallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t begin, uint32_t end)>& function);
+
+	static uint32_t GetThreadCount();
+	// Index of the calling thread in [0, GetThreadCount()), UINT32_MAX for threads the scheduler does not know
+	static uint32_t GetThreadIndex();
+
+	// Checks counters, dependencies and parallel-for coverage under load and logs the result
+	static void RunStressTest();
+	// Logs the speed-up of ParallelFor over a single thread for a memory bound and a compute bound loop
+	static void RunBenchmark(uint32_t elementCount = 4 * 1024 * 1024);
+};
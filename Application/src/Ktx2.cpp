@@ -0,0 +1,197 @@
+#include "Ktx2.h"
+#include "Mipmaps.h"
+#include "Core.h"
+
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+    // The DFD starts with its total size, the basic descriptor block follows. Its third word holds the color model,
+    // primaries, transfer function and flags, one byte each.
+    const uint32_t DFD_TRANSFER_FUNCTION_OFFSET = 4 + 8 + 2;
+    const uint8_t KHR_DF_TRANSFER_SRGB = 2;
+
+    // On-disk layout of the KTX2 header up to the start of the level index
+    struct Ktx2Header
+    {
+        uint8_t identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+}
+
+bool Ktx2::ReadHeader(const std::string& path, Ktx2File& file)
+{
+    std::ifstream stream(path, std::ios::binary);
+
+    if (!stream.is_open())
+    {
+        spdlog::error("Failed to open texture {}", path);
+        return false;
+    }
+
+    Ktx2Header header{};
+    stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    if (!stream || memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+    {
+        spdlog::error("{} is not a KTX2 file", path);
+        return false;
+    }
+
+    // Only plain 2D textures are streamed, arrays, cube maps and volumes are loaded elsewhere
+    if (header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1)
+    {
+        spdlog::error("{} is not a 2D texture", path);
+        return false;
+    }
+
+    file.path = path;
+    file.format = static_cast<VkFormat>(header.vkFormat);
+    file.width = header.pixelWidth;
+    file.height = header.pixelHeight;
+    file.levelCount = std::max(header.levelCount, 1u);
+    file.generateMips = header.levelCount == 0;
+    file.supercompressionScheme = header.supercompressionScheme;
+
+    // Supercompressed files are checked against the transcode target when they are loaded
+    if (!NeedsTranscoding(file) && !IsFormatSupported(file.format))
+    {
+        spdlog::error("{} uses an unsupported format", path);
+        return false;
+    }
+
+    file.levels.resize(file.levelCount);
+    stream.read(reinterpret_cast<char*>(file.levels.data()), sizeof(Ktx2Level) * file.levelCount);
+
+    if (header.dfdByteLength > DFD_TRANSFER_FUNCTION_OFFSET)
+    {
+        uint8_t transferFunction = 0;
+        stream.seekg(static_cast<std::streamoff>(header.dfdByteOffset) + DFD_TRANSFER_FUNCTION_OFFSET);
+        stream.read(reinterpret_cast<char*>(&transferFunction), 1);
+        file.srgb = transferFunction == KHR_DF_TRANSFER_SRGB;
+    }
+
+    // A level count of 0 stores only the base level, the loader builds the rest of the chain
+    if (file.generateMips)
+        file.levelCount = Mipmaps::GetMipLevelCount({ file.width, file.height });
+
+    if (header.sgdByteLength > 0)
+    {
+        auto globalData = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(header.sgdByteLength));
+        stream.seekg(static_cast<std::streamoff>(header.sgdByteOffset));
+        stream.read(reinterpret_cast<char*>(globalData->data()), static_cast<std::streamsize>(header.sgdByteLength));
+        file.supercompressionGlobalData = globalData;
+    }
+
+    return static_cast<bool>(stream);
+}
+
+bool Ktx2::ReadLevel(const Ktx2File& file, uint32_t level, std::vector<uint8_t>& data)
+{
+    std::ifstream stream(file.path, std::ios::binary);
+
+    if (!stream.is_open() || level >= file.levels.size())
+        return false;
+
+    const Ktx2Level& levelInfo = file.levels[level];
+
+    data.resize(static_cast<size_t>(levelInfo.byteLength));
+    stream.seekg(static_cast<std::streamoff>(levelInfo.byteOffset));
+    stream.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(levelInfo.byteLength));
+
+    return static_cast<bool>(stream);
+}
+
+bool Ktx2::NeedsTranscoding(const Ktx2File& file)
+{
+    return file.supercompressionScheme != KTX2_SUPERCOMPRESSION_NONE || file.format == VK_FORMAT_UNDEFINED;
+}
+
+VkExtent2D Ktx2::GetLevelExtent(const Ktx2File& file, uint32_t level)
+{
+    return { std::max(file.width >> level, 1u), std::max(file.height >> level, 1u) };
+}
+
+VkDeviceSize Ktx2::GetLevelSize(VkFormat format, VkExtent2D extent)
+{
+    uint32_t blockWidth, blockHeight, blockBytes;
+    if (!GetBlockInfo(format, blockWidth, blockHeight, blockBytes))
+        return 0;
+
+    // Partial blocks at the edges of small mips still occupy a whole block
+    VkDeviceSize blocksX = (extent.width + blockWidth - 1) / blockWidth;
+    VkDeviceSize blocksY = (extent.height + blockHeight - 1) / blockHeight;
+
+    return blocksX * blocksY * blockBytes;
+}
+
+bool Ktx2::GetBlockInfo(VkFormat format, uint32_t& blockWidth, uint32_t& blockHeight, uint32_t& blockBytes)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        blockWidth = 1; blockHeight = 1; blockBytes = 4;
+        return true;
+
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+        blockWidth = 4; blockHeight = 4; blockBytes = 8;
+        return true;
+
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+    case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+    case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+        blockWidth = 4; blockHeight = 4; blockBytes = 16;
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+bool Ktx2::IsFormatSupported(VkFormat format)
+{
+    uint32_t blockWidth, blockHeight, blockBytes;
+    return GetBlockInfo(format, blockWidth, blockHeight, blockBytes);
+}
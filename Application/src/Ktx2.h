@@ -0,0 +1,66 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <stdint.h>
+
+const uint32_t KTX2_SUPERCOMPRESSION_NONE = 0;
+const uint32_t KTX2_SUPERCOMPRESSION_BASIS_LZ = 1;
+const uint32_t KTX2_SUPERCOMPRESSION_ZSTD = 2;
+const uint32_t KTX2_SUPERCOMPRESSION_ZLIB = 3;
+
+struct Ktx2Level
+{
+	uint64_t byteOffset;
+	uint64_t byteLength;
+	uint64_t uncompressedByteLength;
+};
+
+struct Ktx2File
+{
+	std::string path;
+
+	// VK_FORMAT_UNDEFINED for Basis Universal payloads (ETC1S/UASTC), which always need transcoding
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t levelCount = 0;
+	uint32_t supercompressionScheme = KTX2_SUPERCOMPRESSION_NONE;
+
+	// Transfer function of the data format descriptor, decides between SRGB and UNORM transcode targets
+	bool srgb = false;
+
+	// Set when the file stores level 0 only and asks for the rest of the chain to be generated at load time,
+	// 'levelCount' then covers the full chain while 'levels' holds a single entry
+	bool generateMips = false;
+
+	// Level 0 is the full resolution image
+	std::vector<Ktx2Level> levels;
+
+	// BasisLZ codebooks, shared by every level and every copy of the file description
+	std::shared_ptr<const std::vector<uint8_t>> supercompressionGlobalData;
+};
+
+// Turns one stored level (BasisLZ, UASTC, Zstandard or zlib compressed) into 'targetFormat', runs on the texture workers
+using Ktx2Transcoder = std::function<bool(const Ktx2File& file, uint32_t level, const std::vector<uint8_t>& source, VkFormat targetFormat, std::vector<uint8_t>& destination)>;
+
+class Ktx2
+{
+public:
+	// Reads the header and level index only, the pixel data stays on disk until a level is requested
+	static bool ReadHeader(const std::string& path, Ktx2File& file);
+	static bool ReadLevel(const Ktx2File& file, uint32_t level, std::vector<uint8_t>& data);
+
+	static bool NeedsTranscoding(const Ktx2File& file);
+
+	static VkExtent2D GetLevelExtent(const Ktx2File& file, uint32_t level);
+	static VkDeviceSize GetLevelSize(VkFormat format, VkExtent2D extent);
+
+	// Uncompressed formats report a 1x1 block
+	static bool GetBlockInfo(VkFormat format, uint32_t& blockWidth, uint32_t& blockHeight, uint32_t& blockBytes);
+	static bool IsFormatSupported(VkFormat format);
+};
@@ -8,7 +8,13 @@ public:
 	virtual ~Layer();
 
 	virtual void OnAttach() = 0;
+	// Simulation, runs on the simulation thread when the application uses one
 	virtual void OnUpdate() = 0;
+	// Rendering and UI, always runs on the main thread
+	virtual void OnRender() {}
+
+	// Layers that share no state with the others may have OnUpdate run concurrently on the job system
+	virtual bool IsIndependent() const { return false; }
 
 private:
 };
@@ -1,4 +1,5 @@
 #include "LayerStack.h"
+#include "JobSystem.h"
 
 LayerStack::LayerStack()
 {
@@ -27,9 +28,32 @@ void LayerStack::PopLayer()
 }
 
 void LayerStack::OnUpdate()
+{
+	// Independent layers are handed to the job system first, the rest keep their order on this thread
+	JobCounter independentLayers;
+
+	for (int i = 0; i < m_Layers.size(); i++)
+	{
+		if (m_Layers[i]->IsIndependent())
+		{
+			Layer* layer = m_Layers[i];
+			JobSystem::Run([layer]() { layer->OnUpdate(); }, &independentLayers);
+		}
+	}
+
+	for (int i = 0; i < m_Layers.size(); i++)
+	{
+		if (!m_Layers[i]->IsIndependent())
+			m_Layers[i]->OnUpdate();
+	}
+
+	JobSystem::Wait(independentLayers);
+}
+
+void LayerStack::OnRender()
 {
 	for (int i = 0; i < m_Layers.size(); i++)
 	{
-		m_Layers[i]->OnUpdate();
+		m_Layers[i]->OnRender();
 	}
 }
\ No newline at end of file
@@ -11,6 +11,7 @@ public:
 	void PushLayer(Layer* layer);
 	void LayerStack::PopLayer();
 	void OnUpdate();
+	void OnRender();
 
 
 private:
@@ -0,0 +1,138 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+
+MeshletData MeshletBuilder::Build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices)
+{
+	MeshletData data;
+
+	// Maps a mesh vertex to its slot in the meshlet currently being filled, 0xFF means not yet referenced
+	std::vector<uint8_t> localIndex(positions.size(), 0xFF);
+
+	Meshlet current{};
+
+	auto flush = [&]()
+	{
+		if (current.triangleCount == 0)
+			return;
+
+		// Reset the lookup only for the vertices this meshlet touched
+		for (uint32_t i = 0; i < current.vertexCount; i++)
+			localIndex[data.meshletVertices[current.vertexOffset + i]] = 0xFF;
+
+		ComputeBounds(current, data, positions);
+		data.meshlets.push_back(current);
+
+		current = {};
+		current.vertexOffset = static_cast<uint32_t>(data.meshletVertices.size());
+		current.triangleOffset = static_cast<uint32_t>(data.meshletTriangles.size());
+	};
+
+	// Greedily append triangles in index order, which keeps the clusters spatially coherent
+	// for meshes that were already optimized for vertex cache locality
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		uint32_t a = indices[i + 0];
+		uint32_t b = indices[i + 1];
+		uint32_t c = indices[i + 2];
+
+		uint32_t newVertices = (localIndex[a] == 0xFF) + (localIndex[b] == 0xFF) + (localIndex[c] == 0xFF);
+
+		if (current.vertexCount + newVertices > MESHLET_MAX_VERTICES || current.triangleCount + 1 > MESHLET_MAX_TRIANGLES)
+			flush();
+
+		for (uint32_t vertex : { a, b, c })
+		{
+			if (localIndex[vertex] == 0xFF)
+			{
+				localIndex[vertex] = static_cast<uint8_t>(current.vertexCount++);
+				data.meshletVertices.push_back(vertex);
+			}
+
+			data.meshletTriangles.push_back(localIndex[vertex]);
+		}
+
+		current.triangleCount++;
+	}
+
+	flush();
+
+	return data;
+}
+
+void MeshletBuilder::ComputeBounds(Meshlet& meshlet, const MeshletData& data, const std::vector<glm::vec3>& positions)
+{
+	// Bounding sphere: centroid of the referenced vertices and the furthest distance from it
+	glm::vec3 center(0.0f);
+	for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+		center += positions[data.meshletVertices[meshlet.vertexOffset + i]];
+	center /= static_cast<float>(meshlet.vertexCount);
+
+	float radius = 0.0f;
+	for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+		radius = std::max(radius, glm::length(positions[data.meshletVertices[meshlet.vertexOffset + i]] - center));
+
+	meshlet.center = center;
+	meshlet.radius = radius;
+
+	// Normal cone: average triangle normal and the widest deviation from it
+	std::vector<glm::vec3> normals;
+	normals.reserve(meshlet.triangleCount);
+
+	glm::vec3 axis(0.0f);
+	for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+	{
+		const uint8_t* triangle = &data.meshletTriangles[meshlet.triangleOffset + t * 3];
+
+		glm::vec3 p0 = positions[data.meshletVertices[meshlet.vertexOffset + triangle[0]]];
+		glm::vec3 p1 = positions[data.meshletVertices[meshlet.vertexOffset + triangle[1]]];
+		glm::vec3 p2 = positions[data.meshletVertices[meshlet.vertexOffset + triangle[2]]];
+
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float area = glm::length(normal);
+
+		// Degenerate triangles carry no orientation
+		if (area <= 0.0f)
+			continue;
+
+		normals.push_back(normal / area);
+		axis += normals.back();
+	}
+
+	float axisLength = glm::length(axis);
+
+	if (normals.empty() || axisLength <= 0.0f)
+	{
+		// Cutoff of 1 can never pass the backface test, so the cluster is only frustum culled
+		meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+		meshlet.coneCutoff = 1.0f;
+		return;
+	}
+
+	axis /= axisLength;
+
+	float minDot = 1.0f;
+	for (const glm::vec3& normal : normals)
+		minDot = std::min(minDot, glm::dot(normal, axis));
+
+	meshlet.coneAxis = axis;
+
+	// A spread of 90 degrees or more means some triangle always faces the camera
+	meshlet.coneCutoff = minDot <= 0.0f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+}
+
+bool MeshletBuilder::IsVisible(const Meshlet& meshlet, const glm::vec4 frustumPlanes[6], const glm::vec3& cameraPosition)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		if (glm::dot(glm::vec3(frustumPlanes[i]), meshlet.center) + frustumPlanes[i].w < -meshlet.radius)
+			return false;
+	}
+
+	glm::vec3 toCluster = meshlet.center - cameraPosition;
+	float distance = glm::length(toCluster);
+
+	// Every triangle in the cluster faces away when the view direction lies inside the widened cone
+	return glm::dot(toCluster, meshlet.coneAxis) < meshlet.coneCutoff * distance + meshlet.radius;
+}
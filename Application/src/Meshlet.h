@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <stdint.h>
+
+const uint32_t MESHLET_MAX_VERTICES = 64;
+const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// Layout matches the Meshlet struct in meshlet_cull.comp (std430), keep both in sync
+struct Meshlet
+{
+	uint32_t vertexOffset;   // First entry in MeshletData::meshletVertices
+	uint32_t triangleOffset; // First entry in MeshletData::meshletTriangles (in bytes, 3 per triangle)
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+
+	glm::vec3 center;        // Bounding sphere in object space
+	float radius;
+
+	glm::vec3 coneAxis;      // Normal cone, used to reject clusters facing away from the camera
+	float coneCutoff;
+};
+
+struct MeshletData
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> meshletVertices;  // Cluster-local vertex index -> mesh vertex index
+	std::vector<uint8_t> meshletTriangles;  // Cluster-local triangle list
+};
+
+class MeshletBuilder
+{
+public:
+	static MeshletData Build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices);
+
+	// CPU version of the cluster test in meshlet_cull.comp, planes and camera are in object space
+	static bool IsVisible(const Meshlet& meshlet, const glm::vec4 frustumPlanes[6], const glm::vec3& cameraPosition);
+
+private:
+	static void ComputeBounds(Meshlet& meshlet, const MeshletData& data, const std::vector<glm::vec3>& positions);
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <stdint.h>
+
+class Mipmaps
+{
+public:
+	static uint32_t GetMipLevelCount(VkExtent2D extent);
+
+	// Linear blits need these format features on optimal tiling, block compressed formats never have them
+	static bool SupportsLinearBlit(VkPhysicalDevice physicalDevice, VkFormat format);
+
+	// Expects every level in TRANSFER_DST_OPTIMAL with level 0 filled, leaves all levels in SHADER_READ_ONLY_OPTIMAL.
+	// Only records commands, so chains for many images can share one command buffer and one submission.
+	static void RecordBlitChain(VkCommandBuffer commandBuffer, VkImage image, VkExtent2D extent, uint32_t mipLevels);
+};
@@ -0,0 +1,97 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+
+namespace
+{
+    const uint32_t DEPTH_BITS = 20;
+    // Opaque keys split depth in two, a coarse bucket above material and mesh and the fine depth below them
+    const uint32_t OPAQUE_BUCKET_BITS = 4;
+    const uint32_t OPAQUE_DEPTH_BITS = 16;
+
+    uint64_t QuantizeDepth(float depth, uint32_t bits)
+    {
+        return static_cast<uint64_t>(std::min(std::max(depth, 0.0f), 1.0f) * static_cast<float>((1ull << bits) - 1));
+    }
+}
+
+uint64_t RenderQueue::MakeSortKey(DrawPass pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth)
+{
+    uint64_t key = static_cast<uint64_t>(pass & 0xF) << 60;
+    uint64_t materialMesh = (static_cast<uint64_t>(material & 0xFFFF) << 16) | (mesh & 0xFFFF);
+
+    // Blended draws have to respect depth first
+    if (pass == DrawPassTransparent)
+    {
+        uint64_t depthBits = ((1ull << DEPTH_BITS) - 1) - QuantizeDepth(depth, DEPTH_BITS);
+        return key | (depthBits << 40) | (static_cast<uint64_t>(pipeline & 0xFF) << 32) | materialMesh;
+    }
+
+    // Opaque draws keep pipeline changes rarest and go front to back within each pipeline, so early depth testing
+    // rejects what is hidden. The bucket costs at most 2^OPAQUE_BUCKET_BITS instanced runs per state.
+    uint64_t bucket = QuantizeDepth(depth, OPAQUE_BUCKET_BITS);
+    return key | (static_cast<uint64_t>(pipeline & 0xFF) << 52) | (bucket << 48) | (materialMesh << OPAQUE_DEPTH_BITS) | QuantizeDepth(depth, OPAQUE_DEPTH_BITS);
+}
+
+void RenderQueue::Clear()
+{
+    m_Packets.clear();
+    m_Entries.clear();
+}
+
+void RenderQueue::Reserve(uint32_t count)
+{
+    m_Packets.reserve(count);
+    m_Entries.reserve(count);
+}
+
+void RenderQueue::Push(uint64_t sortKey, const DrawPacket& packet)
+{
+    m_Entries.push_back({ sortKey, static_cast<uint32_t>(m_Packets.size()) });
+    m_Packets.push_back(packet);
+}
+
+void RenderQueue::Sort()
+{
+    size_t count = m_Entries.size();
+    if (count < 2)
+        return;
+
+    m_Scratch.resize(count);
+
+    // One histogram per byte, all built in a single read of the keys
+    uint32_t histograms[8][256] = {};
+    for (const SortEntry& entry : m_Entries)
+    {
+        for (uint32_t digit = 0; digit < 8; digit++)
+            histograms[digit][(entry.key >> (digit * 8)) & 0xFF]++;
+    }
+
+    SortEntry* source = m_Entries.data();
+    SortEntry* destination = m_Scratch.data();
+
+    for (uint32_t digit = 0; digit < 8; digit++)
+    {
+        uint32_t* histogram = histograms[digit];
+
+        // Every key has the same byte here, the order would not change
+        if (histogram[(source[0].key >> (digit * 8)) & 0xFF] == count)
+            continue;
+
+        uint32_t offsets[256];
+        uint32_t sum = 0;
+        for (uint32_t bucket = 0; bucket < 256; bucket++)
+        {
+            offsets[bucket] = sum;
+            sum += histogram[bucket];
+        }
+
+        for (size_t i = 0; i < count; i++)
+            destination[offsets[(source[i].key >> (digit * 8)) & 0xFF]++] = source[i];
+
+        std::swap(source, destination);
+    }
+
+    if (source != m_Entries.data())
+        m_Entries.swap(m_Scratch);
+}
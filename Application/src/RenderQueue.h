@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+// Passes are the most significant part of the sort key, so all opaque draws are recorded before transparent ones
+enum DrawPass : uint32_t
+{
+	DrawPassOpaque = 0,
+	DrawPassTransparent,
+	DrawPassCount
+};
+
+// Everything recordCommandBuffer needs for one object, indices into the renderer's tables
+struct DrawPacket
+{
+	uint32_t pipeline;
+	uint32_t material;
+	uint32_t mesh;
+	// Caller defined, the renderer uses it to find the object's world matrix
+	uint32_t object;
+};
+
+// Draw packets keyed by 64-bit sort keys and ordered with a radix sort, so that recording in sorted order
+// touches each pipeline, material and mesh in one contiguous run.
+//
+// Opaque key:      pass:4 | pipeline:8 | depth bucket:4 | material:16 | mesh:16 | depth:16 (front to back)
+// Transparent key: pass:4 | depth:20 (back to front) | pipeline:8 | material:16 | mesh:16
+class RenderQueue
+{
+public:
+	// 'depth' is the normalized view distance in [0, 1]
+	static uint64_t MakeSortKey(DrawPass pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+
+	void Clear();
+	void Reserve(uint32_t count);
+	void Push(uint64_t sortKey, const DrawPacket& packet);
+
+	// Stable LSD radix sort, 8 bits per pass, passes whose digit is the same for every key are skipped
+	void Sort();
+
+	uint32_t GetCount() const { return static_cast<uint32_t>(m_Packets.size()); }
+	// i-th packet in sorted order
+	const DrawPacket& GetSorted(uint32_t index) const { return m_Packets[m_Entries[index].packet]; }
+
+private:
+	struct SortEntry
+	{
+		uint64_t key;
+		uint32_t packet;
+	};
+
+	std::vector<DrawPacket> m_Packets;
+	std::vector<SortEntry> m_Entries;
+	std::vector<SortEntry> m_Scratch;
+};
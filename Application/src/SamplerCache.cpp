@@ -0,0 +1,110 @@
+#include "SamplerCache.h"
+#include "Core.h"
+
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    struct SamplerDescriptionHash
+    {
+        size_t operator()(const SamplerDescription& description) const
+        {
+            size_t hash = 0;
+            auto combine = [&hash](size_t value) { hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2); };
+
+            combine(description.magFilter);
+            combine(description.minFilter);
+            combine(description.mipmapMode);
+            combine(description.addressModeU);
+            combine(description.addressModeV);
+            combine(description.addressModeW);
+            combine(description.borderColor);
+            combine(std::hash<float>()(description.maxAnisotropy));
+            combine(std::hash<float>()(description.mipLodBias));
+            combine(std::hash<float>()(description.minLod));
+            combine(std::hash<float>()(description.maxLod));
+            combine(description.compareOp);
+
+            return hash;
+        }
+    };
+}
+
+struct SamplerCacheData
+{
+    VkDevice device;
+    SamplerLimits limits;
+    std::unordered_map<SamplerDescription, VkSampler, SamplerDescriptionHash> samplers;
+};
+
+static SamplerCacheData* s_SamplerCacheData = nullptr;
+
+bool SamplerDescription::operator==(const SamplerDescription& other) const
+{
+    return magFilter == other.magFilter && minFilter == other.minFilter && mipmapMode == other.mipmapMode &&
+        addressModeU == other.addressModeU && addressModeV == other.addressModeV && addressModeW == other.addressModeW &&
+        borderColor == other.borderColor && maxAnisotropy == other.maxAnisotropy && mipLodBias == other.mipLodBias &&
+        minLod == other.minLod && maxLod == other.maxLod && compareOp == other.compareOp;
+}
+
+void SamplerCache::Initialize(VkDevice device, const SamplerLimits& limits)
+{
+    s_SamplerCacheData = new SamplerCacheData();
+    s_SamplerCacheData->device = device;
+    s_SamplerCacheData->limits = limits;
+}
+
+void SamplerCache::Shutdown()
+{
+    for (auto& [description, sampler] : s_SamplerCacheData->samplers)
+        vkDestroySampler(s_SamplerCacheData->device, sampler, nullptr);
+
+    delete s_SamplerCacheData;
+    s_SamplerCacheData = nullptr;
+}
+
+VkSampler SamplerCache::GetSampler(const SamplerDescription& description)
+{
+    // Clamp before the lookup so requests that only differ above the device limit end up on the same sampler
+    SamplerDescription key = description;
+    const SamplerLimits& limits = s_SamplerCacheData->limits;
+    key.maxAnisotropy = limits.anisotropySupported ? std::clamp(key.maxAnisotropy, 1.0f, limits.maxAnisotropy) : 1.0f;
+
+    auto it = s_SamplerCacheData->samplers.find(key);
+    if (it != s_SamplerCacheData->samplers.end())
+        return it->second;
+
+    CheckForError(s_SamplerCacheData->samplers.size() >= limits.maxSamplerAllocationCount, "Sampler allocation limit reached!")
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = key.magFilter;
+    samplerInfo.minFilter = key.minFilter;
+    samplerInfo.mipmapMode = key.mipmapMode;
+    samplerInfo.addressModeU = key.addressModeU;
+    samplerInfo.addressModeV = key.addressModeV;
+    samplerInfo.addressModeW = key.addressModeW;
+    samplerInfo.mipLodBias = key.mipLodBias;
+    samplerInfo.anisotropyEnable = key.maxAnisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+    samplerInfo.maxAnisotropy = key.maxAnisotropy;
+    samplerInfo.compareEnable = key.compareOp != VK_COMPARE_OP_NEVER ? VK_TRUE : VK_FALSE;
+    samplerInfo.compareOp = key.compareOp;
+    samplerInfo.minLod = key.minLod;
+    samplerInfo.maxLod = key.maxLod;
+    samplerInfo.borderColor = key.borderColor;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+
+    VkSampler sampler;
+    CheckForError(vkCreateSampler(s_SamplerCacheData->device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS, "Failed to create sampler!")
+
+    s_SamplerCacheData->samplers.emplace(key, sampler);
+    return sampler;
+}
+
+uint32_t SamplerCache::GetSamplerCount()
+{
+    return static_cast<uint32_t>(s_SamplerCacheData->samplers.size());
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <stdint.h>
+
+// Everything that makes two samplers different, requests with equal descriptions share one VkSampler
+struct SamplerDescription
+{
+	VkFilter magFilter = VK_FILTER_LINEAR;
+	VkFilter minFilter = VK_FILTER_LINEAR;
+	VkSamplerMipmapMode mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	VkSamplerAddressMode addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	VkSamplerAddressMode addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	VkSamplerAddressMode addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	VkBorderColor borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+
+	// 1 disables anisotropic filtering, larger values are clamped to the device limit
+	float maxAnisotropy = 1.0f;
+
+	float mipLodBias = 0.0f;
+	float minLod = 0.0f;
+	float maxLod = VK_LOD_CLAMP_NONE;
+
+	// Depth comparison for shadow maps, VK_COMPARE_OP_NEVER leaves it disabled
+	VkCompareOp compareOp = VK_COMPARE_OP_NEVER;
+
+	bool operator==(const SamplerDescription& other) const;
+};
+
+// Queried once during physical device selection
+struct SamplerLimits
+{
+	bool anisotropySupported = false;
+	float maxAnisotropy = 1.0f;
+	uint32_t maxSamplerAllocationCount = 4000;
+};
+
+class SamplerCache
+{
+public:
+	static void Initialize(VkDevice device, const SamplerLimits& limits);
+	static void Shutdown();
+
+	// Owned by the cache and valid until Shutdown, callers never destroy it
+	static VkSampler GetSampler(const SamplerDescription& description);
+
+	static uint32_t GetSamplerCount();
+};
@@ -0,0 +1,187 @@
+#include "SceneGraph.h"
+
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+
+SceneGraph::SceneGraph(uint32_t framesInFlight)
+    : m_FramesInFlight(framesInFlight), m_PendingWrites(framesInFlight)
+{
+}
+
+SceneNode SceneGraph::CreateNode(SceneNode parent)
+{
+    // Appending keeps the order valid, the parent already exists so it sits at a lower index
+    uint32_t index = static_cast<uint32_t>(m_Parents.size());
+    SceneNode node = static_cast<SceneNode>(m_NodeToIndex.size());
+
+    m_Parents.push_back(parent == INVALID_SCENE_NODE ? UINT32_MAX : m_NodeToIndex[parent]);
+    m_LocalTransforms.Add(glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+    m_WorldMatrices.push_back(glm::mat4(1.0f));
+    m_LocalDirty.push_back(0);
+    m_WorldChanged.push_back(0);
+    m_StaleFrames.push_back(0);
+
+    m_NodeToIndex.push_back(index);
+    m_IndexToNode.push_back(node);
+
+    MarkDirty(index);
+    return node;
+}
+
+void SceneGraph::SetParent(SceneNode node, SceneNode parent)
+{
+    uint32_t index = m_NodeToIndex[node];
+    m_Parents[index] = parent == INVALID_SCENE_NODE ? UINT32_MAX : m_NodeToIndex[parent];
+
+    // A parent that now sits behind its child breaks the single pass order
+    if (m_Parents[index] != UINT32_MAX && m_Parents[index] > index)
+        m_NeedsSort = true;
+
+    MarkDirty(index);
+}
+
+void SceneGraph::SetLocalPosition(SceneNode node, const glm::vec3& position)
+{
+    uint32_t index = m_NodeToIndex[node];
+    m_LocalTransforms.SetPosition(index, position);
+    MarkDirty(index);
+}
+
+void SceneGraph::SetLocalRotation(SceneNode node, const glm::quat& rotation)
+{
+    uint32_t index = m_NodeToIndex[node];
+    m_LocalTransforms.SetRotation(index, rotation);
+    MarkDirty(index);
+}
+
+void SceneGraph::SetLocalScale(SceneNode node, const glm::vec3& scale)
+{
+    uint32_t index = m_NodeToIndex[node];
+    m_LocalTransforms.SetScale(index, scale);
+    MarkDirty(index);
+}
+
+void SceneGraph::MarkDirty(uint32_t index)
+{
+    m_LocalDirty[index] = 1;
+    m_FirstDirty = std::min(m_FirstDirty, index);
+}
+
+void SceneGraph::Sort()
+{
+    uint32_t count = GetNodeCount();
+
+    // Depth of every node, walking up the current parent links
+    std::vector<uint32_t> depths(count, 0);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        for (uint32_t parent = m_Parents[i]; parent != UINT32_MAX; parent = m_Parents[parent])
+            depths[i]++;
+    }
+
+    // Sorting by depth puts every parent in front of its children, stable so siblings keep their order
+    std::vector<uint32_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&depths](uint32_t a, uint32_t b) { return depths[a] < depths[b]; });
+
+    std::vector<uint32_t> newIndex(count);
+    for (uint32_t i = 0; i < count; i++)
+        newIndex[order[i]] = i;
+
+    auto permute = [&order](auto& array)
+    {
+        auto sorted = array;
+        for (size_t i = 0; i < order.size(); i++)
+            sorted[i] = array[order[i]];
+        array.swap(sorted);
+    };
+
+    permute(m_Parents);
+    permute(m_IndexToNode);
+
+    TransformSystem sortedTransforms;
+    for (uint32_t i = 0; i < count; i++)
+        sortedTransforms.Add(m_LocalTransforms.GetPosition(order[i]), m_LocalTransforms.GetRotation(order[i]), m_LocalTransforms.GetScale(order[i]));
+    m_LocalTransforms = std::move(sortedTransforms);
+
+    for (uint32_t& parent : m_Parents)
+    {
+        if (parent != UINT32_MAX)
+            parent = newIndex[parent];
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+        m_NodeToIndex[m_IndexToNode[i]] = i;
+
+    // Instance indices moved, every node is rewritten into every frame's buffer
+    for (uint32_t i = 0; i < count; i++)
+        m_LocalDirty[i] = 1;
+
+    m_FirstDirty = 0;
+    m_NeedsSort = false;
+}
+
+void SceneGraph::Update()
+{
+    m_UpdatedNodes = 0;
+
+    if (m_NeedsSort)
+        Sort();
+
+    if (m_FirstDirty == UINT32_MAX)
+        return;
+
+    uint32_t count = GetNodeCount();
+    uint8_t allFrames = static_cast<uint8_t>((1u << m_FramesInFlight) - 1);
+    std::vector<uint32_t> changed;
+
+    // Local matrices of everything from the first dirty node on go through the vector kernels in one pass, the
+    // walk below only has to multiply in the parent
+    m_LocalTransforms.Update(m_FirstDirty / TRANSFORM_BATCH_SIZE * TRANSFORM_BATCH_SIZE, count);
+
+    // Parents come first, so a changed parent has already flagged itself when its children are visited
+    for (uint32_t i = m_FirstDirty; i < count; i++)
+    {
+        uint32_t parent = m_Parents[i];
+        bool parentChanged = parent != UINT32_MAX && m_WorldChanged[parent];
+
+        if (!m_LocalDirty[i] && !parentChanged)
+            continue;
+
+        const glm::mat4& local = m_LocalTransforms.GetWorldMatrix(i);
+        m_WorldMatrices[i] = parent != UINT32_MAX ? m_WorldMatrices[parent] * local : local;
+
+        m_LocalDirty[i] = 0;
+        m_WorldChanged[i] = 1;
+        changed.push_back(i);
+
+        // Queue the copy once per frame buffer, a node that changes again before it is written stays queued
+        for (uint32_t frame = 0; frame < m_FramesInFlight; frame++)
+        {
+            if ((m_StaleFrames[i] & (1u << frame)) == 0)
+                m_PendingWrites[frame].push_back(i);
+        }
+        m_StaleFrames[i] = allFrames;
+    }
+
+    for (uint32_t index : changed)
+        m_WorldChanged[index] = 0;
+
+    m_UpdatedNodes = static_cast<uint32_t>(changed.size());
+    m_FirstDirty = UINT32_MAX;
+}
+
+void SceneGraph::WriteInstances(void* mapped, uint32_t frameIndex)
+{
+    glm::mat4* instances = static_cast<glm::mat4*>(mapped);
+    uint8_t frameBit = static_cast<uint8_t>(1u << frameIndex);
+
+    for (uint32_t index : m_PendingWrites[frameIndex])
+    {
+        memcpy(&instances[index], &m_WorldMatrices[index], sizeof(glm::mat4));
+        m_StaleFrames[index] &= ~frameBit;
+    }
+
+    m_PendingWrites[frameIndex].clear();
+}
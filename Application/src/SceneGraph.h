@@ -0,0 +1,68 @@
+#pragma once
+
+#include "TransformSystem.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+#include <stdint.h>
+
+using SceneNode = uint32_t;
+const SceneNode INVALID_SCENE_NODE = UINT32_MAX;
+
+// Parent/child transforms in one flat array sorted so parents always come before their children.
+// Update walks it once, recomputing only nodes whose local transform or ancestors changed, and the
+// changed world matrices are copied into each frame's instance buffer the next time that frame comes up.
+class SceneGraph
+{
+public:
+	SceneGraph(uint32_t framesInFlight);
+
+	SceneNode CreateNode(SceneNode parent = INVALID_SCENE_NODE);
+	void SetParent(SceneNode node, SceneNode parent);
+
+	void SetLocalPosition(SceneNode node, const glm::vec3& position);
+	void SetLocalRotation(SceneNode node, const glm::quat& rotation);
+	void SetLocalScale(SceneNode node, const glm::vec3& scale);
+
+	// Recomputes world matrices of dirty subtrees, does nothing when no node changed
+	void Update();
+
+	// Copies the world matrices this frame's buffer has not seen yet, 'mapped' holds one mat4 per instance index
+	void WriteInstances(void* mapped, uint32_t frameIndex);
+
+	const glm::mat4& GetWorldMatrix(SceneNode node) const { return m_WorldMatrices[m_NodeToIndex[node]]; }
+	// Position of the node's matrix in the instance buffer, changes when the hierarchy is re-sorted
+	uint32_t GetInstanceIndex(SceneNode node) const { return m_NodeToIndex[node]; }
+
+	uint32_t GetNodeCount() const { return static_cast<uint32_t>(m_Parents.size()); }
+	uint32_t GetUpdatedNodeCount() const { return m_UpdatedNodes; }
+
+private:
+	void MarkDirty(uint32_t index);
+	void Sort();
+
+private:
+	uint32_t m_FramesInFlight;
+
+	// Indexed by sorted position, m_Parents holds sorted positions as well. The transform system's world matrices
+	// are the nodes' local matrices, relative to their parent.
+	std::vector<uint32_t> m_Parents;
+	TransformSystem m_LocalTransforms;
+	std::vector<glm::mat4> m_WorldMatrices;
+
+	std::vector<uint8_t> m_LocalDirty;
+	std::vector<uint8_t> m_WorldChanged;
+	// One bit per frame in flight whose instance buffer still holds an old matrix
+	std::vector<uint8_t> m_StaleFrames;
+
+	// Handles stay stable while the array is re-sorted
+	std::vector<uint32_t> m_NodeToIndex;
+	std::vector<SceneNode> m_IndexToNode;
+
+	std::vector<std::vector<uint32_t>> m_PendingWrites;
+	uint32_t m_FirstDirty = UINT32_MAX;
+	bool m_NeedsSort = false;
+	uint32_t m_UpdatedNodes = 0;
+};
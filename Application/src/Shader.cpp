@@ -45,13 +45,17 @@ struct ShaderData
     VkDevice device;
 };
 
-ShaderData* s_ShaderData = new ShaderData();
+ShaderData* s_ShaderData = nullptr;
 
 Shader::Shader()
+    : Shader("Application/Shaders/vert.spv", "Application/Shaders/frag.spv")
 {
-    // Read vertex and fragment shader code from respective files
-    auto vertShaderCode = Utils::readFile("Application/Shaders/vert.spv");
-    auto fragShaderCode = Utils::readFile("Application/Shaders/frag.spv");
+}
+
+Shader::Shader(const std::string& vertexShaderPath, const std::string& fragmentShaderPath)
+{
+    // Read vertex shader code from file
+    auto vertShaderCode = Utils::readFile(vertexShaderPath);
 
     // Create shader module info for the vertex shader
     VkShaderModuleCreateInfo vertCreateInfo{};
@@ -59,16 +63,8 @@ Shader::Shader()
     vertCreateInfo.codeSize = vertShaderCode.size();
     vertCreateInfo.pCode = reinterpret_cast<const uint32_t*>(vertShaderCode.data());
 
-    // Create shader module info for the fragment shader
-    VkShaderModuleCreateInfo fragCreateInfo{};
-    fragCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    fragCreateInfo.codeSize = fragShaderCode.size();
-    fragCreateInfo.pCode = reinterpret_cast<const uint32_t*>(fragShaderCode.data());
-
     // Create vertex shader module using the device
     vkCreateShaderModule(s_ShaderData->device, &vertCreateInfo, nullptr, &vertShaderModule); 
-    // Create fragment shader module using the device
-    vkCreateShaderModule(s_ShaderData->device, &fragCreateInfo, nullptr, &fragShaderModule); 
 
     // Create vertex shader stage info
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{}; 
@@ -77,6 +73,24 @@ Shader::Shader()
     vertShaderStageInfo.module = vertShaderModule;
     vertShaderStageInfo.pName = "main"; // Entry point function name in the shader code
 
+    shaderStages.push_back(vertShaderStageInfo); 
+
+    // Depth-only pipelines write no color, the rasterizer produces depth without a fragment shader
+    if (fragmentShaderPath.empty())
+        return;
+
+    // Read fragment shader code from file
+    auto fragShaderCode = Utils::readFile(fragmentShaderPath);
+
+    // Create shader module info for the fragment shader
+    VkShaderModuleCreateInfo fragCreateInfo{};
+    fragCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    fragCreateInfo.codeSize = fragShaderCode.size();
+    fragCreateInfo.pCode = reinterpret_cast<const uint32_t*>(fragShaderCode.data());
+
+    // Create fragment shader module using the device
+    vkCreateShaderModule(s_ShaderData->device, &fragCreateInfo, nullptr, &fragShaderModule); 
+
     // Create fragment shader stage info
     VkPipelineShaderStageCreateInfo fragShaderStageInfo{}; 
     fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -84,24 +98,53 @@ Shader::Shader()
     fragShaderStageInfo.module = fragShaderModule;
     fragShaderStageInfo.pName = "main"; // Entry point function name in the shader code
 
-    // Combine shader stage infos into an vector for the pipeline creation
-    shaderStages.push_back(vertShaderStageInfo); 
     shaderStages.push_back(fragShaderStageInfo); 
 }
 
+Shader::Shader(const std::string& computeShaderPath)
+{
+    // Read compute shader code from file
+    auto computeShaderCode = Utils::readFile(computeShaderPath);
+
+    VkShaderModuleCreateInfo computeCreateInfo{};
+    computeCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    computeCreateInfo.codeSize = computeShaderCode.size();
+    computeCreateInfo.pCode = reinterpret_cast<const uint32_t*>(computeShaderCode.data());
+
+    vkCreateShaderModule(s_ShaderData->device, &computeCreateInfo, nullptr, &computeShaderModule);
+
+    VkPipelineShaderStageCreateInfo computeShaderStageInfo{};
+    computeShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    computeShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    computeShaderStageInfo.module = computeShaderModule;
+    computeShaderStageInfo.pName = "main"; // Entry point function name in the shader code
+
+    shaderStages.push_back(computeShaderStageInfo);
+}
+
 Shader::~Shader()
 {
-    vkDestroyShaderModule(s_ShaderData->device, fragShaderModule, nullptr);
-    vkDestroyShaderModule(s_ShaderData->device, vertShaderModule, nullptr);
-    delete s_ShaderData;
-    s_ShaderData = nullptr;
+    // Modules are only needed until the pipeline is created, the shared device data is freed by Shutdown
+    if (computeShaderModule != VK_NULL_HANDLE)
+        vkDestroyShaderModule(s_ShaderData->device, computeShaderModule, nullptr);
+    if (fragShaderModule != VK_NULL_HANDLE)
+        vkDestroyShaderModule(s_ShaderData->device, fragShaderModule, nullptr);
+    if (vertShaderModule != VK_NULL_HANDLE)
+        vkDestroyShaderModule(s_ShaderData->device, vertShaderModule, nullptr);
 }
 
 void Shader::Initialize(VkDevice device)
 {
+    s_ShaderData = new ShaderData();
     s_ShaderData->device = device;
 }
 
+void Shader::Shutdown()
+{
+    delete s_ShaderData;
+    s_ShaderData = nullptr;
+}
+
 std::vector<VkPipelineShaderStageCreateInfo>& Shader::GetShaderStages()
 {
     return shaderStages; 
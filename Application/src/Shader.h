@@ -2,17 +2,25 @@
 
 #include "vulkan/vulkan.h"
 #include <vector>
+#include <string>
 
 class Shader
 {
 public:
+	// The scene's vert.spv and frag.spv
 	Shader();
+	// An empty fragment path leaves the fragment stage out, for depth-only pipelines
+	Shader(const std::string& vertexShaderPath, const std::string& fragmentShaderPath);
+	Shader(const std::string& computeShaderPath);
 	~Shader(); 
 
 	static void Initialize(VkDevice device); 
+	// Frees the shared device data, after the last shader was destroyed
+	static void Shutdown();
 	std::vector<VkPipelineShaderStageCreateInfo>& GetShaderStages(); 
 private:
-	VkShaderModule vertShaderModule;
-	VkShaderModule fragShaderModule;
+	VkShaderModule vertShaderModule = VK_NULL_HANDLE;
+	VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+	VkShaderModule computeShaderModule = VK_NULL_HANDLE;
 	std::vector<VkPipelineShaderStageCreateInfo> shaderStages; 
 };
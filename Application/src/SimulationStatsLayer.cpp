@@ -0,0 +1,43 @@
+#include "SimulationStatsLayer.h"
+#include "FrameTiming.h"
+#include "Core.h"
+
+#include <algorithm>
+
+// Seconds of simulation time between two checks
+static const double REPORT_INTERVAL = 10.0;
+
+SimulationStatsLayer::SimulationStatsLayer()
+	: Layer()
+{
+
+}
+
+SimulationStatsLayer::~SimulationStatsLayer()
+{
+
+}
+
+void SimulationStatsLayer::OnAttach()
+{
+	m_NextReport = FrameTiming::Now() + REPORT_INTERVAL;
+}
+
+void SimulationStatsLayer::OnUpdate()
+{
+	// Steps that are due at once run back to back, every one of them after its logical time
+	double simulationTime = FrameTiming::GetSimulationTime();
+	m_MaxLateness = std::max(m_MaxLateness, FrameTiming::Now() - simulationTime);
+	m_StepCount++;
+
+	if (simulationTime < m_NextReport)
+		return;
+
+	// A step starting more than a whole step late means the simulation had to catch up
+	if (m_MaxLateness > FrameTiming::GetFixedTimestep())
+		spdlog::warn("Simulation fell behind, worst step started {:.1f} ms late over the last {} steps", m_MaxLateness * 1000.0, m_StepCount);
+
+	m_StepCount = 0;
+	m_MaxLateness = 0.0;
+	m_NextReport = simulationTime + REPORT_INTERVAL;
+}
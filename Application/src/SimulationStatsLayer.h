@@ -0,0 +1,23 @@
+#pragma once
+#include "Layer.h"
+
+#include <stdint.h>
+
+// Watches how late fixed steps start compared to their logical time and warns when the simulation falls behind.
+// It touches nothing but its own members, so its OnUpdate runs on the job system next to the other layers.
+class SimulationStatsLayer : public Layer
+{
+public:
+	SimulationStatsLayer();
+	~SimulationStatsLayer();
+
+	void OnAttach();
+	void OnUpdate();
+
+	bool IsIndependent() const { return true; }
+
+private:
+	uint32_t m_StepCount = 0;
+	double m_MaxLateness = 0.0;
+	double m_NextReport = 0.0;
+};
@@ -0,0 +1,864 @@
+#include "TextureManager.h"
+#include "Ktx2.h"
+#include "Mipmaps.h"
+#include "SamplerCache.h"
+#include "BindlessDescriptors.h"
+#include "Core.h"
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+extern uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+extern void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+
+namespace
+{
+    // Levels whose larger side is at or below this size are loaded together as the initial placeholder
+    const uint32_t MIP_TAIL_SIZE = 64;
+    // Caps the number of reads and uploads in flight so streaming never competes with the frame for long
+    const uint32_t MAX_STREAMING_REQUESTS = 4;
+    // Textures that were not requested for this many frames drop their target back to the mip tail
+    const uint64_t REQUEST_GRACE_FRAMES = 60;
+
+    struct StreamedTexture
+    {
+        Ktx2File file;
+        VkFormat format = VK_FORMAT_UNDEFINED;  // Format of the GPU image, the transcode target for supercompressed files
+        bool transcode = false;
+
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkDeviceSize memorySize = 0;
+
+        uint32_t tailMip = 0;       // Finest level of the mip tail, never evicted
+        uint32_t residentMip = 0;   // Finest level on the GPU, levelCount while nothing is resident
+        uint32_t targetMip = 0;     // Finest level requested during the grace window
+        uint64_t lastRequestedFrame = 0;
+        bool busy = false;          // A read or upload for this texture is in flight
+        uint32_t bindlessIndex = INVALID_BINDLESS_INDEX;
+    };
+
+    struct ReadRequest
+    {
+        TextureHandle texture;
+        Ktx2File file;
+        uint32_t firstLevel;
+        uint32_t lastLevel;
+        bool transcode;
+        VkFormat targetFormat;
+    };
+
+    struct ReadResult
+    {
+        TextureHandle texture;
+        uint32_t firstLevel;
+        std::vector<std::vector<uint8_t>> levels;
+        bool success;
+    };
+
+    struct RetiredImage
+    {
+        VkImage image;
+        VkDeviceMemory memory;
+        VkImageView view;
+    };
+
+    // Every residency change and mip chain recorded during one Update shares a command buffer and a submission
+    struct UploadBatch
+    {
+        VkFence fence = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+        std::vector<TextureHandle> textures;
+        std::vector<VkBuffer> stagingBuffers;
+        std::vector<VkDeviceMemory> stagingMemory;
+
+        // Previous images of the textures, destroyed once the GPU is done with them
+        std::vector<RetiredImage> retiredImages;
+    };
+}
+
+struct TextureData
+{
+    VkDevice device;
+    VkPhysicalDevice physicalDevice;
+    VkQueue queue;
+    VkCommandPool commandPool;
+    TextureFormatSupport formatSupport;
+    Ktx2Transcoder transcoder;
+
+    std::vector<StreamedTexture> textures;
+    UploadBatch recordingBatch;
+    std::vector<UploadBatch> pendingBatches;
+    uint32_t pendingUploads = 0;
+    uint32_t pendingReads = 0;
+
+    VkImage placeholderImage;
+    VkDeviceMemory placeholderMemory;
+    VkImageView placeholderView;
+    uint32_t placeholderBindlessIndex;
+
+    // Shared by every streamed texture in the bindless set
+    VkSampler sampler;
+
+    VkDeviceSize residentBytes = 0;
+    VkDeviceSize budgetBytes = 256ull * 1024 * 1024;
+    uint64_t frame = 0;
+
+    // Disk reads and transcoding happen on the workers, every Vulkan call stays on the render thread
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<ReadRequest> readRequests;
+    std::vector<ReadResult> readResults;
+    bool running = false;
+};
+
+static TextureData* s_TextureData = nullptr;
+
+static void WorkerLoop()
+{
+    while (true)
+    {
+        ReadRequest request;
+        Ktx2Transcoder transcoder;
+        {
+            std::unique_lock<std::mutex> lock(s_TextureData->mutex);
+            s_TextureData->condition.wait(lock, [] { return !s_TextureData->readRequests.empty() || !s_TextureData->running; });
+
+            if (!s_TextureData->running)
+                return;
+
+            request = std::move(s_TextureData->readRequests.front());
+            s_TextureData->readRequests.pop_front();
+
+            // SetTranscoder may swap the backend at any time, the copy keeps this request on one
+            if (request.transcode)
+                transcoder = s_TextureData->transcoder;
+        }
+
+        ReadResult result;
+        result.texture = request.texture;
+        result.firstLevel = request.firstLevel;
+        result.success = true;
+
+        for (uint32_t level = request.firstLevel; level <= request.lastLevel && result.success; level++)
+        {
+            result.levels.emplace_back();
+            result.success &= Ktx2::ReadLevel(request.file, level, result.levels.back());
+
+            if (result.success && request.transcode)
+            {
+                std::vector<uint8_t> transcoded;
+                result.success &= transcoder && transcoder(request.file, level, result.levels.back(), request.targetFormat, transcoded);
+                result.levels.back().swap(transcoded);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(s_TextureData->mutex);
+        s_TextureData->readResults.push_back(std::move(result));
+    }
+}
+
+static void CreateImage(VkFormat format, VkExtent2D extent, uint32_t mipLevels, VkImage& image, VkDeviceMemory& memory, VkDeviceSize& memorySize)
+{
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = format;
+    imageInfo.extent.width = extent.width;
+    imageInfo.extent.height = extent.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    // Transfer source is needed so the next residency change can copy the already resident levels over
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    CheckForError(vkCreateImage(s_TextureData->device, &imageInfo, nullptr, &image) != VK_SUCCESS, "Failed to create texture Image!")
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(s_TextureData->device, image, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    CheckForError(vkAllocateMemory(s_TextureData->device, &allocInfo, nullptr, &memory) != VK_SUCCESS, "Failed to allocate texture Image Memory!")
+    vkBindImageMemory(s_TextureData->device, image, memory, 0);
+
+    memorySize = memRequirements.size;
+}
+
+static VkImageView CreateImageView(VkImage image, VkFormat format, uint32_t mipLevels)
+{
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = mipLevels;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    VkImageView view;
+    CheckForError(vkCreateImageView(s_TextureData->device, &viewInfo, nullptr, &view) != VK_SUCCESS, "Failed to create texture Image View!")
+    return view;
+}
+
+static VkImageMemoryBarrier ImageBarrier(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess, uint32_t mipLevels)
+{
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    return barrier;
+}
+
+static VkCommandBuffer GetBatchCommandBuffer()
+{
+    UploadBatch& batch = s_TextureData->recordingBatch;
+
+    if (batch.commandBuffer == VK_NULL_HANDLE)
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = s_TextureData->commandPool;
+        allocInfo.commandBufferCount = 1;
+        vkAllocateCommandBuffers(s_TextureData->device, &allocInfo, &batch.commandBuffer);
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+    }
+
+    return batch.commandBuffer;
+}
+
+// Replaces the image of a texture with one holding levels [newResidentMip, levelCount). Levels passed in
+// 'levels' (starting at newResidentMip) come from the staging buffer, the rest are copied from the old image,
+// or blitted from level 0 for textures whose mips are generated on the GPU.
+// The new view is used from the next recorded frame on, queue ordering keeps it behind the batch.
+static void RecordResidencyChange(TextureHandle handle, uint32_t newResidentMip, const std::vector<std::vector<uint8_t>>& levels)
+{
+    StreamedTexture& texture = s_TextureData->textures[handle];
+    const Ktx2File& file = texture.file;
+    UploadBatch& batch = s_TextureData->recordingBatch;
+    VkCommandBuffer commandBuffer = GetBatchCommandBuffer();
+
+    uint32_t newLevelCount = file.levelCount - newResidentMip;
+    uint32_t oldLevelCount = file.levelCount - texture.residentMip;
+    VkImage oldImage = texture.image;
+
+    // Generated chains are built once from the uploaded level 0, there is never an old image to copy from
+    bool generateMips = file.generateMips && oldImage == VK_NULL_HANDLE;
+
+    VkImage image;
+    VkDeviceMemory memory;
+    VkDeviceSize memorySize;
+    CreateImage(texture.format, Ktx2::GetLevelExtent(file, newResidentMip), newLevelCount, image, memory, memorySize);
+
+    // Pack the new levels into one staging buffer
+    std::vector<VkDeviceSize> stagingOffsets;
+    VkDeviceSize stagingSize = 0;
+    for (const std::vector<uint8_t>& level : levels)
+    {
+        stagingOffsets.push_back(stagingSize);
+        stagingSize += (level.size() + 15) & ~VkDeviceSize(15);
+    }
+
+    VkBuffer stagingBuffer = VK_NULL_HANDLE;
+
+    if (stagingSize > 0)
+    {
+        VkDeviceMemory stagingMemory;
+        CreateBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingMemory);
+
+        uint8_t* data;
+        vkMapMemory(s_TextureData->device, stagingMemory, 0, stagingSize, 0, reinterpret_cast<void**>(&data));
+        for (size_t i = 0; i < levels.size(); i++)
+            memcpy(data + stagingOffsets[i], levels[i].data(), levels[i].size());
+        vkUnmapMemory(s_TextureData->device, stagingMemory);
+
+        batch.stagingBuffers.push_back(stagingBuffer);
+        batch.stagingMemory.push_back(stagingMemory);
+    }
+
+    std::vector<VkImageMemoryBarrier> barriers;
+    barriers.push_back(ImageBarrier(image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT, newLevelCount));
+    if (oldImage != VK_NULL_HANDLE)
+        barriers.push_back(ImageBarrier(oldImage, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, 0, VK_ACCESS_TRANSFER_READ_BIT, oldLevelCount));
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    for (uint32_t level = newResidentMip; level < file.levelCount; level++)
+    {
+        VkExtent2D extent = Ktx2::GetLevelExtent(file, level);
+        uint32_t dataIndex = level - newResidentMip;
+
+        if (dataIndex < levels.size())
+        {
+            VkBufferImageCopy region{};
+            region.bufferOffset = stagingOffsets[dataIndex];
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = level - newResidentMip;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageExtent = { extent.width, extent.height, 1 };
+
+            vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        }
+        else if (!generateMips)
+        {
+            VkImageCopy region{};
+            region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.srcSubresource.mipLevel = level - texture.residentMip;
+            region.srcSubresource.layerCount = 1;
+            region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.dstSubresource.mipLevel = level - newResidentMip;
+            region.dstSubresource.layerCount = 1;
+            region.extent = { extent.width, extent.height, 1 };
+
+            vkCmdCopyImage(commandBuffer, oldImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        }
+    }
+
+    if (generateMips)
+    {
+        // The chain leaves every level ready for sampling
+        Mipmaps::RecordBlitChain(commandBuffer, image, Ktx2::GetLevelExtent(file, newResidentMip), newLevelCount);
+    }
+    else
+    {
+        VkImageMemoryBarrier readBarrier = ImageBarrier(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, newLevelCount);
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+            0, nullptr, 0, nullptr, 1, &readBarrier);
+    }
+
+    if (oldImage != VK_NULL_HANDLE)
+        batch.retiredImages.push_back({ oldImage, texture.memory, texture.view });
+
+    s_TextureData->residentBytes += memorySize;
+    s_TextureData->residentBytes -= texture.memorySize;
+
+    texture.image = image;
+    texture.memory = memory;
+    texture.memorySize = memorySize;
+    texture.view = CreateImageView(image, texture.format, newLevelCount);
+    BindlessDescriptors::UpdateTexture(texture.bindlessIndex, texture.view, s_TextureData->sampler);
+    texture.residentMip = newResidentMip;
+    texture.busy = true;
+
+    batch.textures.push_back(handle);
+    s_TextureData->pendingUploads++;
+}
+
+static void SubmitBatch()
+{
+    UploadBatch& batch = s_TextureData->recordingBatch;
+
+    if (batch.commandBuffer == VK_NULL_HANDLE)
+        return;
+
+    vkEndCommandBuffer(batch.commandBuffer);
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    vkCreateFence(s_TextureData->device, &fenceInfo, nullptr, &batch.fence);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+    CheckForError(vkQueueSubmit(s_TextureData->queue, 1, &submitInfo, batch.fence) != VK_SUCCESS, "Failed to submit texture upload!")
+
+    s_TextureData->pendingBatches.push_back(std::move(batch));
+    s_TextureData->recordingBatch = UploadBatch();
+}
+
+static void RetireBatches(bool wait)
+{
+    auto& batches = s_TextureData->pendingBatches;
+
+    for (size_t i = 0; i < batches.size();)
+    {
+        UploadBatch& batch = batches[i];
+
+        if (wait)
+            vkWaitForFences(s_TextureData->device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+
+        // The fence also covers every frame submitted before the batch, so nothing samples the old images anymore
+        if (vkGetFenceStatus(s_TextureData->device, batch.fence) != VK_SUCCESS)
+        {
+            i++;
+            continue;
+        }
+
+        for (const RetiredImage& retired : batch.retiredImages)
+        {
+            vkDestroyImageView(s_TextureData->device, retired.view, nullptr);
+            vkDestroyImage(s_TextureData->device, retired.image, nullptr);
+            vkFreeMemory(s_TextureData->device, retired.memory, nullptr);
+        }
+
+        for (size_t j = 0; j < batch.stagingBuffers.size(); j++)
+        {
+            vkDestroyBuffer(s_TextureData->device, batch.stagingBuffers[j], nullptr);
+            vkFreeMemory(s_TextureData->device, batch.stagingMemory[j], nullptr);
+        }
+
+        vkFreeCommandBuffers(s_TextureData->device, s_TextureData->commandPool, 1, &batch.commandBuffer);
+        vkDestroyFence(s_TextureData->device, batch.fence, nullptr);
+
+        for (TextureHandle texture : batch.textures)
+            s_TextureData->textures[texture].busy = false;
+
+        s_TextureData->pendingUploads -= static_cast<uint32_t>(batch.textures.size());
+
+        batches[i] = std::move(batches.back());
+        batches.pop_back();
+    }
+}
+
+// Drops the finest resident level of the least recently requested texture that holds more than it needs
+static bool EvictOneLevel()
+{
+    StreamedTexture* victim = nullptr;
+    TextureHandle victimHandle = INVALID_TEXTURE;
+
+    for (TextureHandle handle = 0; handle < s_TextureData->textures.size(); handle++)
+    {
+        StreamedTexture& texture = s_TextureData->textures[handle];
+
+        if (texture.busy || texture.residentMip >= texture.tailMip || texture.residentMip >= texture.targetMip)
+            continue;
+
+        if (victim == nullptr || texture.lastRequestedFrame < victim->lastRequestedFrame)
+        {
+            victim = &texture;
+            victimHandle = handle;
+        }
+    }
+
+    if (victim == nullptr)
+        return false;
+
+    RecordResidencyChange(victimHandle, victim->residentMip + 1, {});
+    return true;
+}
+
+static void CreatePlaceholder()
+{
+    VkDeviceSize memorySize;
+    CreateImage(VK_FORMAT_R8G8B8A8_UNORM, { 1, 1 }, 1, s_TextureData->placeholderImage, s_TextureData->placeholderMemory, memorySize);
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingMemory;
+    CreateBuffer(4, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingMemory);
+
+    void* data;
+    uint32_t white = 0xFFFFFFFF;
+    vkMapMemory(s_TextureData->device, stagingMemory, 0, 4, 0, &data);
+    memcpy(data, &white, sizeof(white));
+    vkUnmapMemory(s_TextureData->device, stagingMemory);
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = s_TextureData->commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    vkAllocateCommandBuffers(s_TextureData->device, &allocInfo, &commandBuffer);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    VkImageMemoryBarrier barrier = ImageBarrier(s_TextureData->placeholderImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT, 1);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = { 1, 1, 1 };
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, s_TextureData->placeholderImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    barrier = ImageBarrier(s_TextureData->placeholderImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, 1);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    vkQueueSubmit(s_TextureData->queue, 1, &submitInfo, VK_NULL_HANDLE);
+    vkQueueWaitIdle(s_TextureData->queue);
+
+    vkFreeCommandBuffers(s_TextureData->device, s_TextureData->commandPool, 1, &commandBuffer);
+    vkDestroyBuffer(s_TextureData->device, stagingBuffer, nullptr);
+    vkFreeMemory(s_TextureData->device, stagingMemory, nullptr);
+
+    s_TextureData->placeholderView = CreateImageView(s_TextureData->placeholderImage, VK_FORMAT_R8G8B8A8_UNORM, 1);
+}
+
+static bool IsSampledFormatSupported(VkFormat format)
+{
+    // Compressed formats also need their feature enabled on the logical device
+    if (format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK && !s_TextureData->formatSupport.bc)
+        return false;
+    if (format >= VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK && format <= VK_FORMAT_EAC_R11G11_SNORM_BLOCK && !s_TextureData->formatSupport.etc2)
+        return false;
+    if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK && !s_TextureData->formatSupport.astc)
+        return false;
+
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(s_TextureData->physicalDevice, format, &properties);
+
+    VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+    return (properties.optimalTilingFeatures & required) == required;
+}
+
+// Basis Universal payloads are transcoded to the best block format the device samples natively. The file's
+// transfer function picks the SRGB or UNORM variant, normal maps and masks must not be linearized when sampled.
+static VkFormat ChooseTranscodeTarget(const Ktx2File& file)
+{
+    // Zstandard/zlib only wrap a regular format, decompressing them yields that format again
+    if (file.format != VK_FORMAT_UNDEFINED)
+        return file.format;
+
+    const VkFormat srgbCandidates[] = { VK_FORMAT_BC7_SRGB_BLOCK, VK_FORMAT_ASTC_4x4_SRGB_BLOCK, VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK, VK_FORMAT_R8G8B8A8_SRGB };
+    const VkFormat linearCandidates[] = { VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_ASTC_4x4_UNORM_BLOCK, VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, VK_FORMAT_R8G8B8A8_UNORM };
+
+    for (VkFormat candidate : file.srgb ? srgbCandidates : linearCandidates)
+    {
+        if (IsSampledFormatSupported(candidate))
+            return candidate;
+    }
+
+    return VK_FORMAT_UNDEFINED;
+}
+
+void TextureManager::Initialize(VkDevice device, VkPhysicalDevice physicalDevice, VkQueue queue, uint32_t queueFamilyIndex, const TextureFormatSupport& formatSupport)
+{
+    s_TextureData = new TextureData();
+    s_TextureData->device = device;
+    s_TextureData->physicalDevice = physicalDevice;
+    s_TextureData->queue = queue;
+    s_TextureData->formatSupport = formatSupport;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+    CheckForError(vkCreateCommandPool(device, &poolInfo, nullptr, &s_TextureData->commandPool) != VK_SUCCESS, "Failed to create texture Command Pool!")
+
+    CreatePlaceholder();
+
+    s_TextureData->sampler = SamplerCache::GetSampler(SamplerDescription{});
+    s_TextureData->placeholderBindlessIndex = BindlessDescriptors::RegisterTexture(s_TextureData->placeholderView, s_TextureData->sampler);
+
+    s_TextureData->running = true;
+
+    // Transcoding is CPU heavy, leave the other half of the cores to the main and render work
+    uint32_t workerCount = std::max(1u, std::thread::hardware_concurrency() / 2);
+    for (uint32_t i = 0; i < workerCount; i++)
+        s_TextureData->workers.emplace_back(WorkerLoop);
+}
+
+void TextureManager::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(s_TextureData->mutex);
+        s_TextureData->running = false;
+    }
+    s_TextureData->condition.notify_all();
+
+    for (std::thread& worker : s_TextureData->workers)
+        worker.join();
+
+    SubmitBatch();
+    RetireBatches(true);
+
+    for (StreamedTexture& texture : s_TextureData->textures)
+    {
+        if (texture.view == VK_NULL_HANDLE)
+            continue;
+
+        vkDestroyImageView(s_TextureData->device, texture.view, nullptr);
+        vkDestroyImage(s_TextureData->device, texture.image, nullptr);
+        vkFreeMemory(s_TextureData->device, texture.memory, nullptr);
+    }
+
+    vkDestroyImageView(s_TextureData->device, s_TextureData->placeholderView, nullptr);
+    vkDestroyImage(s_TextureData->device, s_TextureData->placeholderImage, nullptr);
+    vkFreeMemory(s_TextureData->device, s_TextureData->placeholderMemory, nullptr);
+
+    vkDestroyCommandPool(s_TextureData->device, s_TextureData->commandPool, nullptr);
+
+    delete s_TextureData;
+    s_TextureData = nullptr;
+}
+
+TextureHandle TextureManager::LoadTexture(const std::string& path)
+{
+    StreamedTexture texture;
+
+    // Only the header and level index are read here, the pixel data is read on the worker
+    if (!Ktx2::ReadHeader(path, texture.file))
+        return INVALID_TEXTURE;
+
+    const Ktx2File& file = texture.file;
+
+    // Block compressed data is uploaded as is, the GPU decodes it when sampling
+    texture.transcode = Ktx2::NeedsTranscoding(file);
+    texture.format = texture.transcode ? ChooseTranscodeTarget(file) : file.format;
+
+    if (texture.transcode && !s_TextureData->transcoder)
+    {
+        spdlog::error("{} is supercompressed but no transcoder is registered", path);
+        return INVALID_TEXTURE;
+    }
+
+    if (texture.format == VK_FORMAT_UNDEFINED || !IsSampledFormatSupported(texture.format))
+    {
+        spdlog::error("{} uses a format this device cannot sample", path);
+        return INVALID_TEXTURE;
+    }
+
+    // Generated chains need linear blits, formats without them keep the base level only
+    if (texture.file.generateMips && (texture.transcode || !Mipmaps::SupportsLinearBlit(s_TextureData->physicalDevice, texture.format)))
+    {
+        spdlog::warn("{} asks for generated mips but its format cannot be blitted, loading the base level only", path);
+        texture.file.levelCount = 1;
+        texture.file.generateMips = false;
+    }
+
+    texture.tailMip = file.levelCount - 1;
+    for (uint32_t level = 0; level < file.levelCount; level++)
+    {
+        VkExtent2D extent = Ktx2::GetLevelExtent(file, level);
+        if (std::max(extent.width, extent.height) <= MIP_TAIL_SIZE)
+        {
+            texture.tailMip = level;
+            break;
+        }
+    }
+
+    // Only the base level is on disk, so the whole chain becomes resident in one go and is never streamed
+    uint32_t lastLevel = file.levelCount - 1;
+    if (file.generateMips)
+    {
+        texture.tailMip = 0;
+        lastLevel = 0;
+    }
+
+    texture.residentMip = file.levelCount;
+    texture.targetMip = texture.tailMip;
+    texture.lastRequestedFrame = s_TextureData->frame;
+    texture.busy = true;
+
+    // Shaders sample the placeholder through this slot until the mip tail arrives
+    texture.bindlessIndex = BindlessDescriptors::RegisterTexture(s_TextureData->placeholderView, s_TextureData->sampler);
+
+    TextureHandle handle = static_cast<TextureHandle>(s_TextureData->textures.size());
+    s_TextureData->textures.push_back(texture);
+
+    {
+        std::lock_guard<std::mutex> lock(s_TextureData->mutex);
+        s_TextureData->readRequests.push_back({ handle, texture.file, texture.tailMip, lastLevel, texture.transcode, texture.format });
+        s_TextureData->pendingReads++;
+    }
+    s_TextureData->condition.notify_one();
+
+    return handle;
+}
+
+void TextureManager::SetTranscoder(Ktx2Transcoder transcoder)
+{
+    std::lock_guard<std::mutex> lock(s_TextureData->mutex);
+    s_TextureData->transcoder = transcoder;
+}
+
+void TextureManager::Update()
+{
+    s_TextureData->frame++;
+
+    RetireBatches(false);
+
+    std::vector<ReadResult> results;
+    {
+        std::lock_guard<std::mutex> lock(s_TextureData->mutex);
+        results.swap(s_TextureData->readResults);
+        s_TextureData->pendingReads -= static_cast<uint32_t>(results.size());
+    }
+
+    for (ReadResult& result : results)
+    {
+        StreamedTexture& texture = s_TextureData->textures[result.texture];
+
+        if (!result.success)
+        {
+            spdlog::error("Failed to stream {} level {}", texture.file.path, result.firstLevel);
+            texture.busy = false;
+            continue;
+        }
+
+        RecordResidencyChange(result.texture, result.firstLevel, result.levels);
+    }
+
+    // Textures nobody asked for recently only keep their mip tail as a target
+    for (StreamedTexture& texture : s_TextureData->textures)
+    {
+        if (s_TextureData->frame - texture.lastRequestedFrame > REQUEST_GRACE_FRAMES)
+            texture.targetMip = texture.tailMip;
+    }
+
+    // A lowered budget is enforced right away
+    while (s_TextureData->residentBytes > s_TextureData->budgetBytes && EvictOneLevel());
+
+    // Stream in one level at a time, largest deficit first
+    std::vector<TextureHandle> candidates;
+    for (TextureHandle handle = 0; handle < s_TextureData->textures.size(); handle++)
+    {
+        const StreamedTexture& texture = s_TextureData->textures[handle];
+        if (!texture.busy && texture.residentMip <= texture.tailMip && texture.residentMip > texture.targetMip)
+            candidates.push_back(handle);
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](TextureHandle a, TextureHandle b)
+    {
+        const StreamedTexture& textureA = s_TextureData->textures[a];
+        const StreamedTexture& textureB = s_TextureData->textures[b];
+        return textureA.residentMip - textureA.targetMip > textureB.residentMip - textureB.targetMip;
+    });
+
+    for (TextureHandle handle : candidates)
+    {
+        uint32_t inFlight = s_TextureData->pendingReads + s_TextureData->pendingUploads;
+        if (inFlight >= MAX_STREAMING_REQUESTS)
+            break;
+
+        StreamedTexture& texture = s_TextureData->textures[handle];
+        uint32_t level = texture.residentMip - 1;
+        VkDeviceSize levelSize = Ktx2::GetLevelSize(texture.format, Ktx2::GetLevelExtent(texture.file, level));
+
+        // Make room by evicting levels that other textures no longer need
+        while (s_TextureData->residentBytes + levelSize > s_TextureData->budgetBytes && EvictOneLevel());
+
+        if (s_TextureData->residentBytes + levelSize > s_TextureData->budgetBytes)
+            break;
+
+        texture.busy = true;
+
+        {
+            std::lock_guard<std::mutex> lock(s_TextureData->mutex);
+            s_TextureData->readRequests.push_back({ handle, texture.file, level, level, texture.transcode, texture.format });
+            s_TextureData->pendingReads++;
+        }
+        s_TextureData->condition.notify_one();
+    }
+
+    // Everything recorded this frame goes out in a single submission
+    SubmitBatch();
+}
+
+void TextureManager::RequestMip(TextureHandle texture, uint32_t mipLevel)
+{
+    if (texture == INVALID_TEXTURE)
+        return;
+
+    StreamedTexture& streamedTexture = s_TextureData->textures[texture];
+    mipLevel = std::min(mipLevel, streamedTexture.tailMip);
+
+    // The first request of a frame replaces the old target, later ones can only ask for more detail
+    if (streamedTexture.lastRequestedFrame != s_TextureData->frame)
+        streamedTexture.targetMip = mipLevel;
+    else
+        streamedTexture.targetMip = std::min(streamedTexture.targetMip, mipLevel);
+
+    streamedTexture.lastRequestedFrame = s_TextureData->frame;
+}
+
+uint32_t TextureManager::ComputeMipForScreenSize(TextureHandle texture, float screenPixels)
+{
+    if (texture == INVALID_TEXTURE)
+        return 0;
+
+    const Ktx2File& file = s_TextureData->textures[texture].file;
+
+    float texelsPerPixel = static_cast<float>(std::max(file.width, file.height)) / std::max(screenPixels, 1.0f);
+    float mip = std::floor(std::log2(std::max(texelsPerPixel, 1.0f)));
+
+    return std::min(static_cast<uint32_t>(mip), file.levelCount - 1);
+}
+
+VkImageView TextureManager::GetImageView(TextureHandle texture)
+{
+    if (texture == INVALID_TEXTURE || s_TextureData->textures[texture].view == VK_NULL_HANDLE)
+        return s_TextureData->placeholderView;
+
+    return s_TextureData->textures[texture].view;
+}
+
+uint32_t TextureManager::GetBindlessIndex(TextureHandle texture)
+{
+    if (texture == INVALID_TEXTURE)
+        return s_TextureData->placeholderBindlessIndex;
+
+    return s_TextureData->textures[texture].bindlessIndex;
+}
+
+uint32_t TextureManager::GetResidentMip(TextureHandle texture)
+{
+    return s_TextureData->textures[texture].residentMip;
+}
+
+void TextureManager::SetMemoryBudget(VkDeviceSize bytes)
+{
+    s_TextureData->budgetBytes = bytes;
+}
+
+TextureStats TextureManager::GetStats()
+{
+    TextureStats stats{};
+    stats.textureCount = static_cast<uint32_t>(s_TextureData->textures.size());
+    stats.pendingReads = s_TextureData->pendingReads;
+    stats.pendingUploads = s_TextureData->pendingUploads;
+    stats.residentBytes = s_TextureData->residentBytes;
+    stats.budgetBytes = s_TextureData->budgetBytes;
+    return stats;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+#include "Ktx2.h"
+
+#include <string>
+#include <stdint.h>
+
+using TextureHandle = uint32_t;
+const TextureHandle INVALID_TEXTURE = UINT32_MAX;
+
+// Block compression families the device can sample from, filled in during physical device selection
+struct TextureFormatSupport
+{
+	bool bc = false;
+	bool astc = false;
+	bool etc2 = false;
+};
+
+struct TextureStats
+{
+	uint32_t textureCount;
+	uint32_t pendingReads;
+	uint32_t pendingUploads;
+	VkDeviceSize residentBytes;
+	VkDeviceSize budgetBytes;
+};
+
+class TextureManager
+{
+public:
+	static void Initialize(VkDevice device, VkPhysicalDevice physicalDevice, VkQueue queue, uint32_t queueFamilyIndex, const TextureFormatSupport& formatSupport);
+	static void Shutdown();
+
+	// Required for supercompressed KTX2 files, e.g. a Basis Universal or Zstandard backend
+	static void SetTranscoder(Ktx2Transcoder transcoder);
+
+	// Queues the file for loading and returns immediately, the smallest mips become resident first
+	static TextureHandle LoadTexture(const std::string& path);
+
+	// Called once per frame before recording, retires finished uploads and schedules new stream-in/eviction work
+	static void Update();
+
+	// Marks the mip level a texture is currently sampled at, textures that nobody asks for fall back to their mip tail
+	static void RequestMip(TextureHandle texture, uint32_t mipLevel);
+	static uint32_t ComputeMipForScreenSize(TextureHandle texture, float screenPixels);
+
+	// Returns the placeholder until at least the mip tail is resident
+	static VkImageView GetImageView(TextureHandle texture);
+	// Slot in the bindless texture array, kept pointing at the current view as mips stream in and out
+	static uint32_t GetBindlessIndex(TextureHandle texture);
+	static uint32_t GetResidentMip(TextureHandle texture);
+
+	static void SetMemoryBudget(VkDeviceSize bytes);
+	static TextureStats GetStats();
+};
@@ -0,0 +1,410 @@
+#include "TransformSystem.h"
+#include "Core.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #define TRANSFORM_SIMD 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+        #define TARGET_AVX2
+    #else
+        #define TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#else
+    #define TRANSFORM_SIMD 0
+#endif
+
+namespace
+{
+    // The arrays are padded to the widest kernel
+    uint32_t PaddedCount(uint32_t count)
+    {
+        return (count + TRANSFORM_BATCH_SIZE - 1) / TRANSFORM_BATCH_SIZE * TRANSFORM_BATCH_SIZE;
+    }
+
+#if TRANSFORM_SIMD
+    // Turns four lanes of x, y, z, w into one column of four consecutive matrices
+    inline void StoreColumn(__m128 x, __m128 y, __m128 z, __m128 w, glm::mat4* matrices, int column)
+    {
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        _mm_storeu_ps(&matrices[0][column][0], x);
+        _mm_storeu_ps(&matrices[1][column][0], y);
+        _mm_storeu_ps(&matrices[2][column][0], z);
+        _mm_storeu_ps(&matrices[3][column][0], w);
+    }
+
+    inline void StoreSpheres(__m128 x, __m128 y, __m128 z, __m128 radius, glm::vec4* spheres)
+    {
+        _MM_TRANSPOSE4_PS(x, y, z, radius);
+        _mm_storeu_ps(&spheres[0][0], x);
+        _mm_storeu_ps(&spheres[1][0], y);
+        _mm_storeu_ps(&spheres[2][0], z);
+        _mm_storeu_ps(&spheres[3][0], radius);
+    }
+#endif
+}
+
+TransformSystem::TransformSystem()
+    : m_Kernel(GetBestKernel())
+{
+}
+
+TransformHandle TransformSystem::Add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale, const glm::vec4& localBounds)
+{
+    TransformHandle handle = m_Count;
+    Resize(m_Count + 1);
+
+    SetPosition(handle, position);
+    SetRotation(handle, rotation);
+    SetScale(handle, scale);
+    SetLocalBounds(handle, localBounds);
+
+    return handle;
+}
+
+void TransformSystem::Resize(uint32_t count)
+{
+    m_Count = count;
+    uint32_t padded = PaddedCount(m_Count);
+
+    // Padding lanes hold identity transforms so the kernels can run over them harmlessly
+    if (padded > m_PositionX.size())
+    {
+        for (std::vector<float>* array : { &m_PositionX, &m_PositionY, &m_PositionZ, &m_RotationX, &m_RotationY, &m_RotationZ,
+            &m_BoundsX, &m_BoundsY, &m_BoundsZ, &m_BoundsRadius })
+            array->resize(padded, 0.0f);
+
+        for (std::vector<float>* array : { &m_RotationW, &m_ScaleX, &m_ScaleY, &m_ScaleZ })
+            array->resize(padded, 1.0f);
+
+        m_WorldMatrices.resize(padded, glm::mat4(1.0f));
+        m_WorldBounds.resize(padded, glm::vec4(0.0f));
+    }
+}
+
+void TransformSystem::Clear()
+{
+    m_Count = 0;
+
+    for (std::vector<float>* array : { &m_PositionX, &m_PositionY, &m_PositionZ, &m_RotationX, &m_RotationY, &m_RotationZ, &m_RotationW,
+        &m_ScaleX, &m_ScaleY, &m_ScaleZ, &m_BoundsX, &m_BoundsY, &m_BoundsZ, &m_BoundsRadius })
+        array->clear();
+
+    m_WorldMatrices.clear();
+    m_WorldBounds.clear();
+}
+
+void TransformSystem::SetPosition(TransformHandle transform, const glm::vec3& position)
+{
+    m_PositionX[transform] = position.x;
+    m_PositionY[transform] = position.y;
+    m_PositionZ[transform] = position.z;
+}
+
+void TransformSystem::SetRotation(TransformHandle transform, const glm::quat& rotation)
+{
+    m_RotationX[transform] = rotation.x;
+    m_RotationY[transform] = rotation.y;
+    m_RotationZ[transform] = rotation.z;
+    m_RotationW[transform] = rotation.w;
+}
+
+void TransformSystem::SetScale(TransformHandle transform, const glm::vec3& scale)
+{
+    m_ScaleX[transform] = scale.x;
+    m_ScaleY[transform] = scale.y;
+    m_ScaleZ[transform] = scale.z;
+}
+
+void TransformSystem::SetLocalBounds(TransformHandle transform, const glm::vec4& bounds)
+{
+    m_BoundsX[transform] = bounds.x;
+    m_BoundsY[transform] = bounds.y;
+    m_BoundsZ[transform] = bounds.z;
+    m_BoundsRadius[transform] = bounds.w;
+}
+
+void TransformSystem::Update()
+{
+    Update(0, m_Count);
+}
+
+void TransformSystem::Update(uint32_t first, uint32_t last)
+{
+    last = std::min(last, m_Count);
+    CheckForError(first % TRANSFORM_BATCH_SIZE != 0 || (last % TRANSFORM_BATCH_SIZE != 0 && last != m_Count), "Transform update ranges must cover whole batches!")
+
+    // Only the last batch can be partial, the vector kernels run over its padding lanes
+    uint32_t padded = PaddedCount(last);
+
+    switch (m_Kernel)
+    {
+    case TransformKernel::AVX2: UpdateAVX2(first, padded); break;
+    case TransformKernel::SSE:  UpdateSSE(first, padded); break;
+    default:                    UpdateScalar(first, last); break;
+    }
+}
+
+// World = T * R * S, the rotation columns are scaled and the translation becomes the last column
+void TransformSystem::UpdateScalar(uint32_t first, uint32_t last)
+{
+    for (uint32_t i = first; i < last; i++)
+    {
+        float x = m_RotationX[i], y = m_RotationY[i], z = m_RotationZ[i], w = m_RotationW[i];
+        float sx = m_ScaleX[i], sy = m_ScaleY[i], sz = m_ScaleZ[i];
+
+        glm::vec3 column0 = glm::vec3(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y)) * sx;
+        glm::vec3 column1 = glm::vec3(2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x)) * sy;
+        glm::vec3 column2 = glm::vec3(2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y)) * sz;
+        glm::vec3 position = glm::vec3(m_PositionX[i], m_PositionY[i], m_PositionZ[i]);
+
+        glm::mat4& world = m_WorldMatrices[i];
+        world[0] = glm::vec4(column0, 0.0f);
+        world[1] = glm::vec4(column1, 0.0f);
+        world[2] = glm::vec4(column2, 0.0f);
+        world[3] = glm::vec4(position, 1.0f);
+
+        glm::vec3 center = column0 * m_BoundsX[i] + column1 * m_BoundsY[i] + column2 * m_BoundsZ[i] + position;
+        float maxScale = std::max(std::abs(sx), std::max(std::abs(sy), std::abs(sz)));
+        m_WorldBounds[i] = glm::vec4(center, m_BoundsRadius[i] * maxScale);
+    }
+}
+
+#if TRANSFORM_SIMD
+
+void TransformSystem::UpdateSSE(uint32_t first, uint32_t last)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+
+    for (uint32_t i = first; i < last; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&m_RotationX[i]), y = _mm_loadu_ps(&m_RotationY[i]);
+        __m128 z = _mm_loadu_ps(&m_RotationZ[i]), w = _mm_loadu_ps(&m_RotationW[i]);
+        __m128 sx = _mm_loadu_ps(&m_ScaleX[i]), sy = _mm_loadu_ps(&m_ScaleY[i]), sz = _mm_loadu_ps(&m_ScaleZ[i]);
+
+        __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+        __m128 c0x = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+        __m128 c0y = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+        __m128 c0z = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+
+        __m128 c1x = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+        __m128 c1y = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+        __m128 c1z = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+
+        __m128 c2x = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+        __m128 c2y = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+        __m128 c2z = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+
+        __m128 px = _mm_loadu_ps(&m_PositionX[i]), py = _mm_loadu_ps(&m_PositionY[i]), pz = _mm_loadu_ps(&m_PositionZ[i]);
+
+        glm::mat4* matrices = &m_WorldMatrices[i];
+        StoreColumn(c0x, c0y, c0z, zero, matrices, 0);
+        StoreColumn(c1x, c1y, c1z, zero, matrices, 1);
+        StoreColumn(c2x, c2y, c2z, zero, matrices, 2);
+        StoreColumn(px, py, pz, one, matrices, 3);
+
+        __m128 bx = _mm_loadu_ps(&m_BoundsX[i]), by = _mm_loadu_ps(&m_BoundsY[i]), bz = _mm_loadu_ps(&m_BoundsZ[i]);
+        __m128 centerX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0x, bx), _mm_mul_ps(c1x, by)), _mm_add_ps(_mm_mul_ps(c2x, bz), px));
+        __m128 centerY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0y, bx), _mm_mul_ps(c1y, by)), _mm_add_ps(_mm_mul_ps(c2y, bz), py));
+        __m128 centerZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0z, bx), _mm_mul_ps(c1z, by)), _mm_add_ps(_mm_mul_ps(c2z, bz), pz));
+
+        __m128 maxScale = _mm_max_ps(_mm_andnot_ps(signMask, sx), _mm_max_ps(_mm_andnot_ps(signMask, sy), _mm_andnot_ps(signMask, sz)));
+        __m128 radius = _mm_mul_ps(_mm_loadu_ps(&m_BoundsRadius[i]), maxScale);
+
+        StoreSpheres(centerX, centerY, centerZ, radius, &m_WorldBounds[i]);
+    }
+}
+
+TARGET_AVX2 void TransformSystem::UpdateAVX2(uint32_t first, uint32_t last)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one4 = _mm_set1_ps(1.0f);
+    const int OUTPUT_COUNT = 16;
+
+    for (uint32_t i = first; i < last; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(&m_RotationX[i]), y = _mm256_loadu_ps(&m_RotationY[i]);
+        __m256 z = _mm256_loadu_ps(&m_RotationZ[i]), w = _mm256_loadu_ps(&m_RotationW[i]);
+        __m256 sx = _mm256_loadu_ps(&m_ScaleX[i]), sy = _mm256_loadu_ps(&m_ScaleY[i]), sz = _mm256_loadu_ps(&m_ScaleZ[i]);
+
+        __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+        __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+        __m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+        __m256 c0x = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), sx);
+        __m256 c0y = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx);
+        __m256 c0z = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx);
+
+        __m256 c1x = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy);
+        __m256 c1y = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), sy);
+        __m256 c1z = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy);
+
+        __m256 c2x = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz);
+        __m256 c2y = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz);
+        __m256 c2z = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), sz);
+
+        __m256 px = _mm256_loadu_ps(&m_PositionX[i]), py = _mm256_loadu_ps(&m_PositionY[i]), pz = _mm256_loadu_ps(&m_PositionZ[i]);
+
+        __m256 bx = _mm256_loadu_ps(&m_BoundsX[i]), by = _mm256_loadu_ps(&m_BoundsY[i]), bz = _mm256_loadu_ps(&m_BoundsZ[i]);
+        __m256 centerX = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c0x, bx), _mm256_mul_ps(c1x, by)), _mm256_add_ps(_mm256_mul_ps(c2x, bz), px));
+        __m256 centerY = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c0y, bx), _mm256_mul_ps(c1y, by)), _mm256_add_ps(_mm256_mul_ps(c2y, bz), py));
+        __m256 centerZ = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c0z, bx), _mm256_mul_ps(c1z, by)), _mm256_add_ps(_mm256_mul_ps(c2z, bz), pz));
+
+        __m256 maxScale = _mm256_max_ps(_mm256_andnot_ps(signMask, sx), _mm256_max_ps(_mm256_andnot_ps(signMask, sy), _mm256_andnot_ps(signMask, sz)));
+        __m256 radius = _mm256_mul_ps(_mm256_loadu_ps(&m_BoundsRadius[i]), maxScale);
+
+        // The transposes to array-of-structures work on 128-bit halves, four objects each
+        __m256 outputs[OUTPUT_COUNT] = { c0x, c0y, c0z, c1x, c1y, c1z, c2x, c2y, c2z, px, py, pz, centerX, centerY, centerZ, radius };
+        __m128 halves[2][OUTPUT_COUNT];
+        for (int output = 0; output < OUTPUT_COUNT; output++)
+        {
+            halves[0][output] = _mm256_castps256_ps128(outputs[output]);
+            halves[1][output] = _mm256_extractf128_ps(outputs[output], 1);
+        }
+
+        for (int half = 0; half < 2; half++)
+        {
+            const __m128* lanes = halves[half];
+            glm::mat4* matrices = &m_WorldMatrices[i + half * 4];
+            StoreColumn(lanes[0], lanes[1], lanes[2], zero, matrices, 0);
+            StoreColumn(lanes[3], lanes[4], lanes[5], zero, matrices, 1);
+            StoreColumn(lanes[6], lanes[7], lanes[8], zero, matrices, 2);
+            StoreColumn(lanes[9], lanes[10], lanes[11], one4, matrices, 3);
+
+            StoreSpheres(lanes[12], lanes[13], lanes[14], lanes[15], &m_WorldBounds[i + half * 4]);
+        }
+    }
+}
+
+TransformKernel TransformSystem::GetBestKernel()
+{
+    bool avx2 = false;
+
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] >= 7)
+    {
+        __cpuid(info, 1);
+        bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 0x6) == 0x6;
+
+        __cpuidex(info, 7, 0);
+        avx2 = osSavesYmm && (info[1] & (1 << 5));
+    }
+#else
+    avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+    // SSE2 is part of every x86-64 CPU
+    return avx2 ? TransformKernel::AVX2 : TransformKernel::SSE;
+}
+
+#else
+
+void TransformSystem::UpdateSSE(uint32_t first, uint32_t last)
+{
+    UpdateScalar(first, std::min(last, m_Count));
+}
+
+void TransformSystem::UpdateAVX2(uint32_t first, uint32_t last)
+{
+    UpdateScalar(first, std::min(last, m_Count));
+}
+
+TransformKernel TransformSystem::GetBestKernel()
+{
+    return TransformKernel::Scalar;
+}
+
+#endif
+
+const char* TransformSystem::GetKernelName(TransformKernel kernel)
+{
+    switch (kernel)
+    {
+    case TransformKernel::AVX2: return "AVX2";
+    case TransformKernel::SSE:  return "SSE";
+    default:                    return "Scalar";
+    }
+}
+
+void TransformSystem::RunBenchmark(uint32_t objectCount, uint32_t iterations)
+{
+    using Clock = std::chrono::high_resolution_clock;
+
+    TransformSystem system;
+    std::vector<glm::vec3> positions(objectCount), scales(objectCount);
+    std::vector<glm::quat> rotations(objectCount);
+    std::vector<glm::vec4> bounds(objectCount);
+
+    for (uint32_t i = 0; i < objectCount; i++)
+    {
+        float t = static_cast<float>(i);
+        positions[i] = glm::vec3(std::sin(t), std::cos(t * 0.5f), t * 0.01f);
+        rotations[i] = glm::angleAxis(t * 0.1f, glm::normalize(glm::vec3(1.0f, t, 2.0f)));
+        scales[i] = glm::vec3(1.0f + 0.001f * t, 1.0f, 0.5f);
+        bounds[i] = glm::vec4(0.1f, 0.2f, 0.3f, 1.0f);
+        system.Add(positions[i], rotations[i], scales[i], bounds[i]);
+    }
+
+    // Reference: one object at a time through glm, the way ImGuiOnUpdate builds its model matrix
+    std::vector<glm::mat4> referenceMatrices(objectCount);
+    std::vector<glm::vec4> referenceBounds(objectCount);
+
+    auto start = Clock::now();
+    for (uint32_t iteration = 0; iteration < iterations; iteration++)
+    {
+        for (uint32_t i = 0; i < objectCount; i++)
+        {
+            glm::mat4 world = glm::translate(glm::mat4(1.0f), positions[i]) * glm::mat4_cast(rotations[i]) * glm::scale(glm::mat4(1.0f), scales[i]);
+            glm::vec3 center = glm::vec3(world * glm::vec4(glm::vec3(bounds[i]), 1.0f));
+            float maxScale = std::max(std::abs(scales[i].x), std::max(std::abs(scales[i].y), std::abs(scales[i].z)));
+
+            referenceMatrices[i] = world;
+            referenceBounds[i] = glm::vec4(center, bounds[i].w * maxScale);
+        }
+    }
+    double referenceMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterations;
+    spdlog::info("Transform benchmark, {} objects: glm {:.3f} ms", objectCount, referenceMs);
+
+    TransformKernel best = GetBestKernel();
+    for (TransformKernel kernel : { TransformKernel::Scalar, TransformKernel::SSE, TransformKernel::AVX2 })
+    {
+        if (kernel > best)
+            break;
+
+        system.SetKernel(kernel);
+
+        start = Clock::now();
+        for (uint32_t iteration = 0; iteration < iterations; iteration++)
+            system.Update();
+        double kernelMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterations;
+
+        // Results have to match the reference up to float rounding
+        float maxError = 0.0f;
+        for (uint32_t i = 0; i < objectCount; i++)
+        {
+            for (int column = 0; column < 4; column++)
+                maxError = std::max(maxError, glm::length(system.GetWorldMatrix(i)[column] - referenceMatrices[i][column]));
+            maxError = std::max(maxError, glm::length(system.GetWorldBounds()[i] - referenceBounds[i]));
+        }
+
+        spdlog::info("Transform benchmark, {} objects: {} {:.3f} ms ({:.1f}x), max error {}", objectCount, GetKernelName(kernel),
+            kernelMs, referenceMs / kernelMs, maxError);
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+#include <stdint.h>
+
+using TransformHandle = uint32_t;
+
+// Width of the widest kernel, ranges passed to Update are made of whole batches
+const uint32_t TRANSFORM_BATCH_SIZE = 8;
+
+// Which kernel Update runs, picked once from the CPU features
+enum class TransformKernel
+{
+	Scalar,
+	SSE,
+	AVX2
+};
+
+// Positions, rotations and scales stored as structure-of-arrays, so world matrices and world bounding spheres
+// can be computed 4 (SSE) or 8 (AVX2) objects at a time. Outputs stay array-of-structures for upload.
+class TransformSystem
+{
+public:
+	TransformSystem();
+
+	TransformHandle Add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale, const glm::vec4& localBounds = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	// Sets the count without touching existing slots, for callers that refill every transform each frame
+	void Resize(uint32_t count);
+	void Clear();
+
+	void SetPosition(TransformHandle transform, const glm::vec3& position);
+	void SetRotation(TransformHandle transform, const glm::quat& rotation);
+	void SetScale(TransformHandle transform, const glm::vec3& scale);
+	// Object space sphere, xyz center and w radius
+	void SetLocalBounds(TransformHandle transform, const glm::vec4& bounds);
+
+	glm::vec3 GetPosition(TransformHandle transform) const { return glm::vec3(m_PositionX[transform], m_PositionY[transform], m_PositionZ[transform]); }
+	glm::quat GetRotation(TransformHandle transform) const { return glm::quat(m_RotationW[transform], m_RotationX[transform], m_RotationY[transform], m_RotationZ[transform]); }
+	glm::vec3 GetScale(TransformHandle transform) const { return glm::vec3(m_ScaleX[transform], m_ScaleY[transform], m_ScaleZ[transform]); }
+
+	// Recomputes every world matrix and world bounding sphere
+	void Update();
+	// Recomputes [first, last) only, both on batch boundaries or 'last' at the end. Disjoint ranges touch disjoint
+	// memory, so jobs can split the work between them.
+	void Update(uint32_t first, uint32_t last);
+
+	uint32_t GetCount() const { return m_Count; }
+	const glm::mat4& GetWorldMatrix(TransformHandle transform) const { return m_WorldMatrices[transform]; }
+	const glm::mat4* GetWorldMatrices() const { return m_WorldMatrices.data(); }
+	const glm::vec4* GetWorldBounds() const { return m_WorldBounds.data(); }
+
+	void SetKernel(TransformKernel kernel) { m_Kernel = kernel; }
+	TransformKernel GetKernel() const { return m_Kernel; }
+	static TransformKernel GetBestKernel();
+	static const char* GetKernelName(TransformKernel kernel);
+
+	// Times the per-object glm path against every kernel the CPU supports and logs the results
+	static void RunBenchmark(uint32_t objectCount, uint32_t iterations = 100);
+
+private:
+	void UpdateScalar(uint32_t first, uint32_t last);
+	void UpdateSSE(uint32_t first, uint32_t last);
+	void UpdateAVX2(uint32_t first, uint32_t last);
+
+private:
+	uint32_t m_Count = 0;
+	TransformKernel m_Kernel;
+
+	// Padded to a multiple of 8 so the vector kernels never need a masked tail
+	std::vector<float> m_PositionX, m_PositionY, m_PositionZ;
+	std::vector<float> m_RotationX, m_RotationY, m_RotationZ, m_RotationW;
+	std::vector<float> m_ScaleX, m_ScaleY, m_ScaleZ;
+	std::vector<float> m_BoundsX, m_BoundsY, m_BoundsZ, m_BoundsRadius;
+
+	std::vector<glm::mat4> m_WorldMatrices;
+	std::vector<glm::vec4> m_WorldBounds;
+};
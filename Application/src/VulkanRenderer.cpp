@@ -13,6 +13,18 @@
 #include "Window.h"
 #include "VulkanUtils.h"
 #include "Shader.h"
+#include "Meshlet.h"
+#include "TextureManager.h"
+#include "SamplerCache.h"
+#include "BindlessDescriptors.h"
+#include "DescriptorAllocator.h"
+#include "TransformSystem.h"
+#include "SceneGraph.h"
+#include "EntityRegistry.h"
+#include "RenderQueue.h"
+#include "JobSystem.h"
+#include "FrameSnapshot.h"
+#include "FrameTiming.h"
 
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
@@ -24,6 +36,10 @@
 #include <vector>
 #include <array>
 #include <memory>
+#include <mutex>
+#include <functional>
+#include <algorithm>
+#include <cmath>
 
 struct Vertex
 {
@@ -66,13 +82,168 @@ const std::vector<uint16_t> indices = {
     0, 1, 2, 2, 3, 0
 };
 
+// Per-frame data only, per-draw data goes through DrawConstants
 struct UniformBufferObject
 {
-    glm::mat4 model;
     glm::mat4 view;
     glm::mat4 proj;
 };
 
+struct Camera
+{
+    glm::vec3 position = glm::vec3(2.0f, 2.0f, 2.0f);
+    glm::vec3 target = glm::vec3(0.0f, 0.0f, 0.0f);
+    glm::vec3 up = glm::vec3(0.0f, 0.0f, 1.0f);
+    float fovY = 45.0f;
+    float nearPlane = 0.1f;
+    float farPlane = 10.0f;
+};
+
+// Blocks of the UBO that are tracked separately, each one is only rebuilt and written when its inputs change
+enum UniformBlock : uint32_t
+{
+    UniformBlockView = 0,
+    UniformBlockProjection,
+    UniformBlockCount
+};
+
+// Layout of a Material in the materials storage buffer (std430), textures are indices into the bindless array
+struct GpuMaterial
+{
+    glm::vec4 baseColor;
+    uint32_t albedoTexture;
+    uint32_t padding[3];
+};
+
+// Layout of the push constant block in shader.vert and shader.frag, 72 of the 128 bytes every device guarantees.
+// Scene nodes read their world matrix from the instance buffer at 'objectId', 'model' is only used for draws outside the scene.
+struct DrawConstants
+{
+    glm::mat4 model;
+    uint32_t materialIndex;
+    uint32_t objectId;
+};
+
+// objectId of a draw that supplies its own model matrix
+const uint32_t NO_SCENE_INSTANCE = UINT32_MAX;
+
+const uint32_t MAX_MATERIALS = 1024;
+// Textures the UI can show at once
+const uint32_t IMGUI_MAX_TEXTURES = 16;
+// The materials buffer is registered first, shader.frag hardcodes its slot
+const uint32_t MATERIAL_BUFFER_BINDLESS_INDEX = 0;
+// World matrices of the scene graph, one buffer per frame in flight behind a single slot, shader.vert hardcodes it
+const uint32_t INSTANCE_BUFFER_BINDLESS_INDEX = 1;
+const uint32_t MAX_SCENE_INSTANCES = 16384;
+// Entities are extracted into the instance buffer every frame, behind the scene graph's range
+const uint32_t ENTITY_INSTANCE_OFFSET = MAX_SCENE_INSTANCES;
+const uint32_t MAX_ENTITY_INSTANCES = 131072;
+
+// Geometry an entity's MeshRef points at
+struct Mesh
+{
+    VkBuffer vertexBuffer;
+    VkBuffer indexBuffer;
+    VkIndexType indexType;
+    uint32_t indexCount;
+    // Vertex positions alone, tightly packed in the vertex buffer's position format. The depth prepass only
+    // fetches these, a third of the bytes of the full vertices.
+    VkBuffer positionBuffer;
+};
+
+// CPU side of a material, decides where its draws land in the sort order
+struct MaterialInfo
+{
+    DrawPass pass;
+    uint32_t pipeline;
+    TextureHandle albedoTexture;    // Streamed at the detail its largest visible draw asks for
+};
+
+// Index of the main graphics pipeline in the pipeline table
+const uint32_t DEFAULT_PIPELINE = 0;
+
+// Sort key of a candidate that did not survive culling, real keys never reach it since the pass is at most 1
+const uint64_t CULLED_SORT_KEY = UINT64_MAX;
+
+// Quiet period after the last window resize event before the swapchain is rebuilt
+const double RESIZE_SETTLE_SECONDS = 0.1;
+
+// Weight of a new sample in the smoothed input-to-present latency
+const double LATENCY_SMOOTHING = 0.1;
+
+// Share of the frame budget the scene may take on the GPU under dynamic resolution, the rest is left for the
+// upscale, the UI and measurement noise
+const double DYNAMIC_RESOLUTION_HEADROOM = 0.85;
+// Fraction of the way to the predicted scale taken per measurement. Going down is fast so a load spike costs
+// no frames, going up is slow so the scale does not oscillate around the budget.
+const float RESOLUTION_SCALE_DOWN_RATE = 0.75f;
+const float RESOLUTION_SCALE_UP_RATE = 0.05f;
+// Relative distance to the target GPU time below which the scale is left alone
+const double RESOLUTION_SCALE_DEADBAND = 0.05;
+const float MIN_RESOLUTION_SCALE = 0.25f;
+
+// Layout of the push constant block in upscale.frag
+struct UpscaleConstants
+{
+    glm::vec2 uvScale;
+    glm::vec2 uvMax;
+    glm::vec2 texelSize;
+    uint32_t upscaler;
+    float sharpness;
+};
+
+// State changes of the last recorded frame
+struct DrawStats
+{
+    uint32_t drawCalls = 0;
+    uint32_t pipelineBinds = 0;
+    uint32_t meshBinds = 0;
+    uint32_t prepassDrawCalls = 0;
+};
+
+enum class RenderingBackend
+{
+    DynamicRendering,
+    ImagelessFramebuffer
+};
+
+// InitImGui is written against this backend API, Scripts/Win-GenProjects.bat fetches the matching release
+static_assert(IMGUI_VERSION_NUM == 19090, "Dear ImGui v1.90.9-docking is required, see Scripts/Win-GenProjects.bat");
+
+#ifdef IMGUI_IMPL_VULKAN_HAS_DYNAMIC_RENDERING
+const bool IMGUI_SUPPORTS_DYNAMIC_RENDERING = true;
+#else
+const bool IMGUI_SUPPORTS_DYNAMIC_RENDERING = false;
+#endif
+
+// Depth attachment of one render target. Nothing reads it after its pass, so a single image serves every frame in
+// flight, BeginRendering orders each pass's use after the previous one.
+struct DepthBuffer
+{
+    VkImage image = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+};
+
+// Color images the scene renders into and something samples afterwards, one per frame in flight
+struct OffscreenTargets
+{
+    std::vector<VkImage> images;
+    std::vector<VkDeviceMemory> memory;
+    std::vector<VkImageView> views;
+    DepthBuffer depth;
+    // Imageless, shared by all the images. Null with dynamic rendering.
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    VkExtent2D extent = { 0, 0 };
+};
+
+// Objects frames in flight may still use, destroyed once the last frame that could see them has retired
+struct DeferredDestruction
+{
+    uint64_t lastUsedFrame;
+    std::function<void()> destroy;
+};
+
 struct VulkanData
 {
     VkInstance instance;
@@ -80,6 +251,12 @@ struct VulkanData
 
     VkDevice device;
     VkPhysicalDevice physicalDevice;
+    VkPhysicalDeviceFeatures supportedFeatures;
+    TextureFormatSupport textureFormatSupport;
+    SamplerLimits samplerLimits;
+    BindlessLimits bindlessLimits;
+    // What PhysicalDevice found, CreateLogicalDevice enables only what is set here
+    VkPhysicalDeviceDescriptorIndexingFeatures supportedIndexingFeatures;
 
     /*This member represents the index of the queue family that supports graphics commands.
     Graphics commands are used for rendering operations, such as drawing triangles,
@@ -98,15 +275,46 @@ struct VulkanData
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
 
-    VkRenderPass renderPass;
+    // Picked once per device, every depth buffer and every pipeline that tests depth uses it
+    VkFormat depthFormat;
+    DepthBuffer swapChainDepth;
+
+    // Presentation policy, a change marks the swapchain for recreation
+    PresentPolicy presentPolicy = PresentPolicy::LowLatency;
+    uint32_t requestedImageCount = 0;
+    bool swapChainSettingsChanged = false;
+    VkPresentModeKHR presentMode;
+    double refreshInterval = 1.0 / 60.0;
+    double inputToPresentLatency = 0.0;
+
+    // Dynamic rendering needs neither render passes nor framebuffers. The fallback keeps one imageless
+    // framebuffer per render pass that any swapchain image of the right size can be bound to.
+    RenderingBackend renderingBackend = RenderingBackend::ImagelessFramebuffer;
+    PFN_vkCmdBeginRenderingKHR cmdBeginRendering = nullptr;
+    PFN_vkCmdEndRenderingKHR cmdEndRendering = nullptr;
+
+    VkRenderPass renderPass = VK_NULL_HANDLE;
     VkPipelineLayout pipelineLayout;
     VkPipeline graphicsPipeline;
 
-    std::vector<VkFramebuffer> swapChainFramebuffers;
+    // Lays down the depth of the opaque draws first, the shading pass then only runs for the visible fragment
+    // of each pixel. Shares the graphics pipeline's layout.
+    VkPipeline depthPrepassPipeline;
+    bool EnableDepthPrepass = true;
+    // Shading variant of the graphics pipeline for draws the prepass covered, tests EQUAL and writes no depth
+    VkPipeline depthEqualPipeline;
+
+    VkFramebuffer swapChainFramebuffer = VK_NULL_HANDLE;
+
+    // Number of frames submitted so far, ages deferred destruction
+    uint64_t frameNumber = 0;
+    std::vector<DeferredDestruction> deferredDestructions;
 
     VkCommandPool commandPool;
 
     std::vector<VkCommandBuffer> commandBuffers;
+    // The scene's offscreen passes, submitted ahead of 'commandBuffers' without waiting for the swapchain image
+    std::vector<VkCommandBuffer> sceneCommandBuffers;
 
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
@@ -115,11 +323,7 @@ struct VulkanData
 
     //ImGuiStuff
 
-    VkCommandPool imGuiCommandPool;
     VkDescriptorPool imGuiDescriptorPool;
-    VkRenderPass imGuiRenderPass;
-    std::vector<VkFramebuffer> imGuiFramebuffers;
-    VkCommandBuffer imGuiCommandBuffer;
 
     std::vector<std::string> successQueue;
 
@@ -127,6 +331,8 @@ struct VulkanData
     VkDeviceMemory vertexBufferMemory;
     VkBuffer indexBuffer; 
     VkDeviceMemory indexBufferMemory; 
+    VkBuffer positionBuffer;
+    VkDeviceMemory positionBufferMemory;
 
     VkDescriptorSetLayout descriptorSetLayout; 
 
@@ -134,24 +340,140 @@ struct VulkanData
     std::vector<VkDeviceMemory> uniformBuffersMemory; 
     std::vector<void*> uniformBuffersMapped;
 
-    VkDescriptorPool descriptorPool;
+    // Long lived sets come from descriptorAllocator, sets that only live for one frame from that frame's allocator
+    DescriptorAllocator descriptorAllocator;
+    std::vector<DescriptorAllocator> frameDescriptorAllocators;
     std::vector<VkDescriptorSet> descriptorSets; 
+
+    //Meshlet Culling
+
+    VkBuffer meshletBuffer;
+    VkDeviceMemory meshletBufferMemory;
+    VkBuffer meshletVertexBuffer;
+    VkDeviceMemory meshletVertexBufferMemory;
+    VkBuffer meshletTriangleBuffer;
+    VkDeviceMemory meshletTriangleBufferMemory;
+
+    // Written by the cull pass, one per frame in flight so a frame never overwrites indices still being drawn
+    std::vector<VkBuffer> compactedIndexBuffers;
+    std::vector<VkDeviceMemory> compactedIndexBuffersMemory;
+    std::vector<VkBuffer> drawCommandBuffers;
+    std::vector<VkDeviceMemory> drawCommandBuffersMemory;
+
+    VkDescriptorSetLayout meshletCullSetLayout;
+    std::vector<VkDescriptorSet> meshletCullDescriptorSets;
+    VkPipelineLayout meshletCullPipelineLayout;
+    VkPipeline meshletCullPipeline;
+
+    uint32_t meshletCount = 0;
+    uint32_t meshletIndexCapacity = 0;
+    bool EnableMeshletCulling = true;
     
     //ImGuiViewportvRendering 
 
-    std::vector<VkImage> viewportImages;
-    std::vector<VkDeviceMemory> imageMemory;
-    std::vector<VkImageView> viewportImageViews;
-    VkRenderPass viewportRenderPass;
-    VkPipeline viewportPipeline;
-    VkCommandPool viewportCommandPool;
-    std::vector<VkFramebuffer> viewportFramebuffers;
-    std::vector<VkCommandBuffer> viewportCommandBuffers;
+    // With the viewport enabled the scene renders into these instead of the swapchain, sized to the panel so
+    // only the pixels it shows are shaded. One target per frame in flight, the UI samples the one its frame wrote.
+    bool EnableViewport = true;
+    bool viewportVisible = false;
+    OffscreenTargets viewportTargets;
+    // ImGui descriptors of the targets, made once per resize instead of every frame
+    std::vector<VkDescriptorSet> viewportTextures;
+    // Panel size in pixels, the targets follow once it stopped changing for RESIZE_SETTLE_SECONDS
+    VkExtent2D viewportRequestedExtent = { 0, 0 };
+    double viewportResizeTime = 0.0;
+
+    // Render pass of every offscreen target, leaves the image ready to be sampled. Imageless backend only.
+    VkRenderPass offscreenRenderPass = VK_NULL_HANDLE;
+
+    // Dynamic resolution: the scene renders into the top left 'sceneRenderExtent' of its own targets, which are
+    // allocated at maxResolutionScale of the output, and is upscaled from there. A new scale needs no new images.
+    bool EnableDynamicResolution = false;
+    Upscaler upscaler = Upscaler::EdgeAdaptive;
+    float upscaleSharpness = 0.5f;
+    float minResolutionScale = 0.5f;
+    float maxResolutionScale = 1.0f;
+    float resolutionScale = 1.0f;
+    OffscreenTargets sceneColorTargets;
+    VkExtent2D sceneRenderExtent = { 0, 0 };
+    VkDescriptorSetLayout upscaleSetLayout;
+    VkPipelineLayout upscalePipelineLayout;
+    VkPipeline upscalePipeline;
+    VkSampler upscaleSampler;
+
+    // Two timestamps per frame in flight around the scene's GPU work, read back once the frame's fence signaled
+    VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+    // Nanoseconds per timestamp tick, 0 if the graphics queue cannot write timestamps
+    double timestampPeriod = 0.0;
+    bool timestampsWritten[MAX_FRAMES_IN_FLIGHT] = {};
+    double gpuSceneTime = 0.0;
+
+    // Every material lives in one storage buffer, reachable through the bindless set
+    VkBuffer materialBuffer;
+    VkDeviceMemory materialBufferMemory;
+    GpuMaterial* materialsMapped;
+    uint32_t materialBufferIndex;
+    uint32_t materialCount = 0;
+    uint32_t defaultMaterial;
+    uint32_t checkerMaterial;
+
+    // The scene graph writes changed world matrices straight into the buffer of the frame being recorded
+    VkBuffer instanceBuffers[MAX_FRAMES_IN_FLIGHT];
+    VkDeviceMemory instanceBuffersMemory[MAX_FRAMES_IN_FLIGHT];
+    void* instanceBuffersMapped[MAX_FRAMES_IN_FLIGHT];
+    uint32_t instanceBufferIndex;
 
     VkSampler textureSampler;    
     UniformBufferObject ubo{};  
+
+    SceneGraph scene = SceneGraph(MAX_FRAMES_IN_FLIGHT);
+    SceneNode quadNode;
+
+    // Renderable objects are entities with Transform, MeshRef, MaterialRef and Bounds. The registry belongs to
+    // the simulation thread, rendering only ever sees the snapshots it publishes.
+    EntityRegistry entities;
+    SnapshotExchange snapshots;
+    uint64_t renderedSimulationFrame = 0;
+    bool renderedSnapshotChanged = false;
+    float interpolationAlpha = 0.0f;
+
+    // Simulation side copy of the last published transforms, becomes the next snapshot's previous step
+    std::vector<Transform> lastPublishedTransforms;
+    uint64_t lastPublishedStructure = UINT64_MAX;
+
+    // Entity edits requested from the render thread (UI), applied at the start of the next simulation step
+    std::mutex simulationCommandsMutex;
+    std::vector<std::function<void(EntityRegistry&)>> simulationCommands;
+    std::vector<Mesh> meshes;
+    std::vector<VkPipeline> pipelines;
+    // Entry per pipeline above, used for opaque draws while the depth prepass is on
+    std::vector<VkPipeline> depthEqualPipelines;
+    std::vector<MaterialInfo> materialInfos;
+
+    // Visible entities of this frame, packets reference their world matrix in entityTransforms by slot
+    RenderQueue renderQueue;
+    std::vector<uint64_t> candidateKeys;
+    std::vector<DrawPacket> candidatePackets;
+    TransformSystem entityTransforms;
+    std::vector<float> extractedScreenSizes;
+    std::vector<float> materialScreenSizes;
+    float extractionMilliseconds = 0.0f;
+    DrawStats drawStats;
+
+    // CPU copy of the UBO is rebuilt from these only when they differ from what it was built with
+    Camera camera;
+    Camera uboCamera;
+    VkExtent2D uboExtent = { 0, 0 };
+    bool uboInitialized = false;
+
+    // One bit per frame in flight whose uniform buffer still holds an old copy of the block
+    uint32_t uniformDirtyFrames[UniformBlockCount] = {};
+    uint32_t uniformBytesWritten = 0;
     bool EnableImGui = true;
 
+    // On-demand rendering: reasons to keep drawing even though no event invalidated the window
+    bool animateQuad = true;
+    bool uiTextInputActive = false;
+
     float f = 0.0f;
 };
 
@@ -159,29 +481,93 @@ static VulkanData s_VulkanData;
 
 uint32_t currentFrame = 0; 
 
+// The UI shows the scene in its viewport panel, the swapchain pass then only draws the UI
+static bool SceneInViewport()
+{
+    return s_VulkanData.EnableImGui && s_VulkanData.EnableViewport;
+}
+
+// A hidden viewport panel leaves nothing of the scene on screen
+static bool SceneVisible()
+{
+    return !SceneInViewport() || s_VulkanData.viewportVisible;
+}
+
+// With dynamic resolution the scene renders into the corner of its own target, what ends up in the output is
+// the upscaled copy
+static bool SceneUpscaled()
+{
+    return SceneVisible() && !s_VulkanData.sceneColorTargets.images.empty();
+}
+
+// The scene never touches the swapchain image, its passes go into the scene command buffer
+static bool SceneOffscreen()
+{
+    return SceneVisible() && (SceneUpscaled() || SceneInViewport());
+}
+
+// Size of the image the scene ends up in, the viewport target or the swapchain image. With dynamic resolution
+// the scene renders smaller and is upscaled to this.
+static VkExtent2D GetOutputExtent()
+{
+    return SceneInViewport() ? s_VulkanData.viewportTargets.extent : s_VulkanData.swapChainExtent;
+}
+
+// Hands objects to DestroyRetiredObjects, 'destroy' runs once the frames in flight now have retired
+static void DeferDestruction(std::function<void()> destroy)
+{
+    s_VulkanData.deferredDestructions.push_back({ s_VulkanData.frameNumber, std::move(destroy) });
+}
+
 void VulkanRenderer::VulkanInit()
 {
     CreateInstance();
     CreateSurface();
     PhysicalDevice();  
     CreateLogicalDevice(); 
+    SamplerCache::Initialize(s_VulkanData.device, s_VulkanData.samplerLimits);
+    BindlessDescriptors::Initialize(s_VulkanData.device, s_VulkanData.bindlessLimits, MAX_FRAMES_IN_FLIGHT);
     CreateSwapChain(); 
     CreateImageViews(); 
+    CreateDepthResources();
 
   
     CreateDescriptorSetLayout();   
     CreateGraphicsPipeline(); 
+    s_VulkanData.pipelines.push_back(s_VulkanData.graphicsPipeline);
+    s_VulkanData.depthEqualPipelines.push_back(s_VulkanData.depthEqualPipeline);
+    CreateOffscreenRenderPass();
+    CreateUpscalePipeline();
+    CreateTimestampQueries();
 
       
     CreateFramebuffers(); 
     CreateCommandPool();  
+
+    TextureManager::Initialize(s_VulkanData.device, s_VulkanData.physicalDevice, s_VulkanData.graphicsQueue,
+        Utils::findQueueFamilies(s_VulkanData.physicalDevice, s_VulkanData.surface).graphicsFamily.value(), s_VulkanData.textureFormatSupport);
+    CreateMaterialBuffer();
+    CreateInstanceBuffers();
+
     CreateVertexBuffer();  
     CreateIndexBuffer();
+    CreatePositionBuffer();
+
+    s_VulkanData.meshes.push_back({ s_VulkanData.vertexBuffer, s_VulkanData.indexBuffer, VK_INDEX_TYPE_UINT16, static_cast<uint32_t>(indices.size()), s_VulkanData.positionBuffer });
+    CheckForError(s_VulkanData.meshes.size() - 1 != QUAD_MESH, "Quad must be the first mesh!")
+
+    s_VulkanData.quadNode = s_VulkanData.scene.CreateNode();
 
     CreateUniformBuffers();
     CreateDescriptorPool();    
     CreateDescriptorSets(); 
 
+    if (s_VulkanData.EnableMeshletCulling)
+    {
+        CreateMeshletBuffers();
+        CreateMeshletCullPipeline();
+    }
+
     CreateCommandBuffer(); 
     CreateSyncObjects(); 
 
@@ -209,7 +595,15 @@ void VulkanRenderer::CreateInstance()
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "Engine One";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    appInfo.apiVersion = VK_API_VERSION_1_2;
+
+    // Descriptor indexing and the Features2 queries are core 1.2, a 1.0 loader rejects any apiVersion above 1.0
+    // and has no vkEnumerateInstanceVersion to ask
+    uint32_t instanceVersion = VK_API_VERSION_1_0;
+    auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+    if (enumerateInstanceVersion)
+        enumerateInstanceVersion(&instanceVersion);
+    CheckForError(instanceVersion < VK_API_VERSION_1_2, "The Vulkan loader does not support Vulkan 1.2!")
 
     // Retrieving required GLFW extensions and count for window creation. 
     glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount); 
@@ -240,6 +634,11 @@ void VulkanRenderer::CreateInstance()
         VulkanMessageCallback::SetupDebugMessenger(s_VulkanData.instance);
 }
 
+static const char* RenderingBackendName(RenderingBackend backend)
+{
+    return backend == RenderingBackend::DynamicRendering ? "Dynamic rendering" : "Imageless framebuffers";
+}
+
 void VulkanRenderer::PhysicalDevice()
 {
     // Initialize device count to zero
@@ -269,9 +668,84 @@ void VulkanRenderer::PhysicalDevice()
         }
     }
 
-    CheckForError(s_VulkanData.physicalDevice == VK_NULL_HANDLE, "Failed to find a suitable GPU!")
+    CheckForError(s_VulkanData.physicalDevice == VK_NULL_HANDLE, "Failed to find a suitable GPU, the renderer needs Vulkan 1.2 with descriptor indexing!")
     s_VulkanData.successQueue.push_back("Suitable GPU found!");
 
+    // Record which block compression families the GPU can sample, textures are uploaded in one of these
+    vkGetPhysicalDeviceFeatures(s_VulkanData.physicalDevice, &s_VulkanData.supportedFeatures);
+    s_VulkanData.textureFormatSupport.bc = s_VulkanData.supportedFeatures.textureCompressionBC == VK_TRUE;
+    s_VulkanData.textureFormatSupport.astc = s_VulkanData.supportedFeatures.textureCompressionASTC_LDR == VK_TRUE;
+    s_VulkanData.textureFormatSupport.etc2 = s_VulkanData.supportedFeatures.textureCompressionETC2 == VK_TRUE;
+
+    s_VulkanData.successQueue.push_back(std::string("Texture compression: BC ") + (s_VulkanData.textureFormatSupport.bc ? "yes" : "no") +
+        ", ASTC " + (s_VulkanData.textureFormatSupport.astc ? "yes" : "no") + ", ETC2 " + (s_VulkanData.textureFormatSupport.etc2 ? "yes" : "no"));
+
+    // Sampler limits are fixed per device, query them once here instead of on every sampler creation
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(s_VulkanData.physicalDevice, &properties);
+    s_VulkanData.samplerLimits.anisotropySupported = s_VulkanData.supportedFeatures.samplerAnisotropy == VK_TRUE;
+    s_VulkanData.samplerLimits.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
+    s_VulkanData.samplerLimits.maxSamplerAllocationCount = properties.limits.maxSamplerAllocationCount;
+
+    s_VulkanData.depthFormat = Utils::findDepthFormat(s_VulkanData.physicalDevice);
+    CheckForError(s_VulkanData.depthFormat == VK_FORMAT_UNDEFINED, "No supported depth format found!")
+
+    // Every graphics queue can write timestamps when this is set, they are what dynamic resolution measures with
+    s_VulkanData.timestampPeriod = properties.limits.timestampComputeAndGraphics ? properties.limits.timestampPeriod : 0.0;
+
+    // The bindless set's descriptor indexing features, isDeviceSuitable only picks devices that have all of them
+    VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+    // Render target features, dynamic rendering is preferred and imageless framebuffers are the fallback
+    VkPhysicalDeviceImagelessFramebufferFeatures imagelessFeatures{};
+    imagelessFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGELESS_FRAMEBUFFER_FEATURES;
+    indexingFeatures.pNext = &imagelessFeatures;
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    imagelessFeatures.pNext = &dynamicRenderingFeatures;
+
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &indexingFeatures;
+    vkGetPhysicalDeviceFeatures2(s_VulkanData.physicalDevice, &features2);
+
+    // ImGui's pipeline has to be built for the same kind of render target as everything else
+    bool dynamicRendering = Utils::isDeviceExtensionSupported(s_VulkanData.physicalDevice, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) &&
+        dynamicRenderingFeatures.dynamicRendering && (IMGUI_SUPPORTS_DYNAMIC_RENDERING || !s_VulkanData.EnableImGui);
+
+    if (dynamicRendering)
+        s_VulkanData.renderingBackend = RenderingBackend::DynamicRendering;
+    else
+    {
+        CheckForError(!imagelessFeatures.imagelessFramebuffer, "Neither dynamic rendering nor imageless framebuffers are supported by this GPU!")
+        s_VulkanData.renderingBackend = RenderingBackend::ImagelessFramebuffer;
+    }
+    s_VulkanData.successQueue.push_back(std::string("Rendering backend: ") + RenderingBackendName(s_VulkanData.renderingBackend));
+
+    VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+    indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &indexingProperties;
+    vkGetPhysicalDeviceProperties2(s_VulkanData.physicalDevice, &properties2);
+
+    s_VulkanData.bindlessLimits.supported = indexingFeatures.runtimeDescriptorArray && indexingFeatures.descriptorBindingPartiallyBound &&
+        indexingFeatures.shaderSampledImageArrayNonUniformIndexing && indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+        indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind;
+
+    // The chain pointed at stack structs, only the feature bits are kept
+    s_VulkanData.supportedIndexingFeatures = indexingFeatures;
+    s_VulkanData.supportedIndexingFeatures.pNext = nullptr;
+
+    // Combined image samplers count against the sampler limits as well as the sampled image limits
+    s_VulkanData.bindlessLimits.maxTextures = std::min({ indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages, indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers });
+    s_VulkanData.bindlessLimits.maxStorageBuffers = std::min(indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers);
 }
 
 
@@ -302,6 +776,37 @@ void VulkanRenderer::CreateLogicalDevice()
 
     // Specify device features that the logical device will support
     VkPhysicalDeviceFeatures deviceFeatures{};
+    deviceFeatures.textureCompressionBC = s_VulkanData.supportedFeatures.textureCompressionBC;
+    deviceFeatures.textureCompressionASTC_LDR = s_VulkanData.supportedFeatures.textureCompressionASTC_LDR;
+    deviceFeatures.textureCompressionETC2 = s_VulkanData.supportedFeatures.textureCompressionETC2;
+    deviceFeatures.samplerAnisotropy = s_VulkanData.supportedFeatures.samplerAnisotropy;
+
+    // Descriptor indexing features used by the bindless set, device selection skipped GPUs missing one
+    const VkPhysicalDeviceDescriptorIndexingFeatures& supportedIndexing = s_VulkanData.supportedIndexingFeatures;
+    VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    indexingFeatures.runtimeDescriptorArray = supportedIndexing.runtimeDescriptorArray;
+    indexingFeatures.descriptorBindingPartiallyBound = supportedIndexing.descriptorBindingPartiallyBound;
+    indexingFeatures.shaderSampledImageArrayNonUniformIndexing = supportedIndexing.shaderSampledImageArrayNonUniformIndexing;
+    indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = supportedIndexing.descriptorBindingSampledImageUpdateAfterBind;
+    indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = supportedIndexing.descriptorBindingStorageBufferUpdateAfterBind;
+
+    bool dynamicRendering = s_VulkanData.renderingBackend == RenderingBackend::DynamicRendering;
+
+    VkPhysicalDeviceImagelessFramebufferFeatures imagelessFeatures{};
+    imagelessFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGELESS_FRAMEBUFFER_FEATURES;
+    imagelessFeatures.imagelessFramebuffer = dynamicRendering ? VK_FALSE : VK_TRUE;
+    indexingFeatures.pNext = &imagelessFeatures;
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+    if (dynamicRendering)
+        imagelessFeatures.pNext = &dynamicRenderingFeatures;
+
+    std::vector<const char*> enabledExtensions = deviceExtensions;
+    if (dynamicRendering)
+        enabledExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
 
     // Create info structure for the logical device
     VkDeviceCreateInfo createInfo{};
@@ -309,10 +814,11 @@ void VulkanRenderer::CreateLogicalDevice()
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pEnabledFeatures = &deviceFeatures;
+    createInfo.pNext = &indexingFeatures;
 
     // Specify device extensions that the logical device will use
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
     // Check if validation layers are enabled
     if (enableValidationLayers)
@@ -329,6 +835,12 @@ void VulkanRenderer::CreateLogicalDevice()
 
     CheckForError(vkCreateDevice(s_VulkanData.physicalDevice, &createInfo, nullptr, &s_VulkanData.device) != VK_SUCCESS, "Failed to create Logical Device!")
 
+    if (dynamicRendering)
+    {
+        s_VulkanData.cmdBeginRendering = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(s_VulkanData.device, "vkCmdBeginRenderingKHR");
+        s_VulkanData.cmdEndRendering = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(s_VulkanData.device, "vkCmdEndRenderingKHR");
+    }
+
     vkGetDeviceQueue(s_VulkanData.device, indices.graphicsFamily.value(), 0, &s_VulkanData.graphicsQueue);
     s_VulkanData.successQueue.push_back("Successfully retrieved Graphics Queue Family!");
 
@@ -356,13 +868,10 @@ void VulkanRenderer::CreateSwapChain()
     SwapChainSupportDetails swapChainSupport = Utils::SwapChain::querySwapChainSupport(s_VulkanData.physicalDevice, s_VulkanData.surface);
 
     VkSurfaceFormatKHR surfaceFormat = Utils::SwapChain::chooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode = Utils::SwapChain::chooseSwapPresentMode(swapChainSupport.presentModes);
+    VkPresentModeKHR presentMode = Utils::SwapChain::chooseSwapPresentMode(swapChainSupport.presentModes, s_VulkanData.presentPolicy);
     VkExtent2D extent = Utils::SwapChain::chooseSwapExtent(swapChainSupport.capabilities);
 
-    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-
-    if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) 
-        imageCount = swapChainSupport.capabilities.maxImageCount;
+    uint32_t imageCount = Utils::SwapChain::chooseSwapImageCount(swapChainSupport.capabilities, presentMode, s_VulkanData.requestedImageCount);
     
     VkSwapchainCreateInfoKHR createInfo{}; 
     createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR; 
@@ -377,7 +886,8 @@ void VulkanRenderer::CreateSwapChain()
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;  
+    // Handing over the old swapchain lets the driver reuse its resources, and frames already presented from it stay valid
+    createInfo.oldSwapchain = s_VulkanData.swapChain;
 
     CheckForError(vkCreateSwapchainKHR(s_VulkanData.device, &createInfo, nullptr, &s_VulkanData.swapChain) != VK_SUCCESS, "Failed to create swap chain!")
     s_VulkanData.successQueue.push_back("Swap Chain successfully created!");
@@ -393,6 +903,12 @@ void VulkanRenderer::CreateSwapChain()
 
     s_VulkanData.swapChainImageFormat = surfaceFormat.format;
     s_VulkanData.swapChainExtent = extent;
+    s_VulkanData.presentMode = presentMode;
+
+    // Refresh rate of the monitor the window is most likely on, only used for the latency estimate
+    const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    if (videoMode && videoMode->refreshRate > 0)
+        s_VulkanData.refreshInterval = 1.0 / videoMode->refreshRate;
 }
 
 void VulkanRenderer::CreateImageViews()
@@ -430,6 +946,21 @@ void VulkanRenderer::CreateImageViews()
     }
 }
 
+// Cleared at the start of every pass and dropped at its end, nothing reads depth afterwards
+static VkAttachmentDescription DepthAttachmentDescription()
+{
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = s_VulkanData.depthFormat;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    return depthAttachment;
+}
+
 void VulkanRenderer::CreateRenderPass()
 {
     VkAttachmentDescription colorAttachment{}; 
@@ -446,23 +977,31 @@ void VulkanRenderer::CreateRenderPass()
     colorAttachmentRef.attachment = 0; // Index of the attachment in the render pass                                                           
     colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL; // Layout of the attachment during this subpass                      
                                                                                                                                                
+    std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, DepthAttachmentDescription() };
+
+    VkAttachmentReference depthAttachmentRef{};
+    depthAttachmentRef.attachment = 1;
+    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+                                                                                                                                               
     VkSubpassDescription subpass{};                                                                                                            
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS; // Bind point for this subpass                                                
     subpass.colorAttachmentCount = 1; // Number of color attachments in this subpass                                                           
     subpass.pColorAttachments = &colorAttachmentRef; // Array of color attachment references                                                   
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
                                                                                                                                                
+    // The depth buffer is shared by the frames in flight, its clear waits for the previous frame's depth tests
     VkSubpassDependency dependency{}; 
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL; 
     dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT; 
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT; 
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT; 
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT; 
+    dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT; 
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT; 
 
     VkRenderPassCreateInfo renderPassInfo{};                                                                                                  
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO; // Type of the structure                                                
-    renderPassInfo.attachmentCount = 1; // Number of attachments                                                                              
-    renderPassInfo.pAttachments = &colorAttachment; // Array of attachment descriptions                                                       
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size()); // Number of attachments                                                                              
+    renderPassInfo.pAttachments = attachments.data(); // Array of attachment descriptions                                                       
     renderPassInfo.subpassCount = 1; // Number of subpasses                                                                                   
     renderPassInfo.pSubpasses = &subpass; // Array of subpass descriptions                       
     renderPassInfo.dependencyCount = 1;                                                          
@@ -474,7 +1013,8 @@ void VulkanRenderer::CreateRenderPass()
 
 void VulkanRenderer::CreateGraphicsPipeline()
 {
-    CreateRenderPass(); 
+    if (s_VulkanData.renderingBackend == RenderingBackend::ImagelessFramebuffer)
+        CreateRenderPass(); 
     Shader::Initialize(s_VulkanData.device);  
     Shader* shader = new Shader(); 
 
@@ -567,13 +1107,32 @@ void VulkanRenderer::CreateGraphicsPipeline()
     colorBlending.blendConstants[2] = 0.0f; // Optional: Blend constants for B component
     colorBlending.blendConstants[3] = 0.0f; // Optional: Blend constants for A component
 
+    // Without the depth prepass the shading pass resolves visibility itself, see depthEqualPipeline for the variant
+    // that runs after it
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
+    // Set 0 holds the per-frame uniforms, set 1 is the bindless set shared by every pipeline
+    std::array<VkDescriptorSetLayout, 2> setLayouts = { s_VulkanData.descriptorSetLayout, BindlessDescriptors::GetSetLayout() };
+
+    // Per-draw data (model matrix, material and object index) is pushed, the UBO only holds per-frame matrices
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(DrawConstants);
+
     // Create pipeline layout info
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1; // Descriptor layout 
-    pipelineLayoutInfo.pSetLayouts = &s_VulkanData.descriptorSetLayout; // Descriptor layout 
-    pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional: Number of push constant ranges 
-    pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional: Push constant ranges 
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size()); // Descriptor layouts 
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data(); // Descriptor layouts 
+    pipelineLayoutInfo.pushConstantRangeCount = 1; // Number of push constant ranges 
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange; // Push constant ranges 
 
     CheckForError(vkCreatePipelineLayout(s_VulkanData.device, &pipelineLayoutInfo, nullptr, &s_VulkanData.pipelineLayout) != VK_SUCCESS, "Failed to create Pipeline Layout!")
     s_VulkanData.successQueue.push_back("Pipeline Layout successfully created!");
@@ -589,47 +1148,118 @@ void VulkanRenderer::CreateGraphicsPipeline()
     pipelineInfo.pViewportState = &viewportState; // Set the viewport state configuration                                                           
     pipelineInfo.pRasterizationState = &rasterizer; // Set the rasterization state configuration                                                    
     pipelineInfo.pMultisampleState = &multisampling; // Set the multisample state configuration                                                     
-    pipelineInfo.pDepthStencilState = nullptr; // Set the depth and stencil state configuration (set to nullptr for not using them)                 
+    pipelineInfo.pDepthStencilState = &depthStencil; // Set the depth and stencil state configuration
     pipelineInfo.pColorBlendState = &colorBlending; // Set the color blend state configuration                                                      
     pipelineInfo.pDynamicState = &dynamicState; // Set the dynamic state configuration                                                                                                                     
                                                                                                                                                                                                            
     pipelineInfo.layout = s_VulkanData.pipelineLayout; // Set the pipeline layout (assuming s_VulkanData.pipelineLayout is defined)                                                                      
     pipelineInfo.renderPass = s_VulkanData.renderPass; // Set the render pass (assuming s_VulkanData.renderPass is defined)                                                                              
     pipelineInfo.subpass = 0; // Specify the subpass index                                                                                                                                                 
+
+    // Without a render pass the pipeline only needs to know the attachment formats it renders to
+    VkPipelineRenderingCreateInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &s_VulkanData.swapChainImageFormat;
+    renderingInfo.depthAttachmentFormat = s_VulkanData.depthFormat;
+    if (s_VulkanData.renderingBackend == RenderingBackend::DynamicRendering)
+        pipelineInfo.pNext = &renderingInfo;
                                                                                                                                                                                                            
                                                                                                                                                                                                            
     CheckForError(vkCreateGraphicsPipelines(s_VulkanData.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &s_VulkanData.graphicsPipeline) != VK_SUCCESS, "Failed to create Graphics Pipeline!") 
     s_VulkanData.successQueue.push_back("Graphics Pipeline successfully created!");
+
+    // After the prepass the buffer already holds the nearest depth of every pixel. Only the fragment that wrote it
+    // passes EQUAL, and writing the same value again would only cost bandwidth. Both vertex shaders declare
+    // gl_Position invariant, so the depths compare exactly.
+    depthStencil.depthWriteEnable = VK_FALSE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_EQUAL;
+
+    CheckForError(vkCreateGraphicsPipelines(s_VulkanData.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &s_VulkanData.depthEqualPipeline) != VK_SUCCESS, "Failed to create depth equal Graphics Pipeline!")
+    s_VulkanData.successQueue.push_back("Depth equal Graphics Pipeline successfully created!");
        
     delete shader;
     shader = nullptr;
+
+    // The depth prepass differs only in what it reads and writes: positions only, no fragment shader, no color.
+    // Strict LESS keeps the nearest surface when instances overlap at equal depth.
+    Shader* prepassShader = new Shader("Application/Shaders/depth_prepass_vert.spv", "");
+
+    VkVertexInputBindingDescription positionBinding{};
+    positionBinding.binding = 0;
+    positionBinding.stride = sizeof(glm::vec2);
+    positionBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    VkVertexInputAttributeDescription positionAttribute = attributeDescriptions[0];
+    positionAttribute.offset = 0;
+
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.pVertexBindingDescriptions = &positionBinding;
+    vertexInputInfo.vertexAttributeDescriptionCount = 1;
+    vertexInputInfo.pVertexAttributeDescriptions = &positionAttribute;
+
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    colorBlendAttachment.colorWriteMask = 0;
+
+    pipelineInfo.stageCount = static_cast<uint32_t>(prepassShader->GetShaderStages().size());
+    pipelineInfo.pStages = prepassShader->GetShaderStages().data();
+
+    CheckForError(vkCreateGraphicsPipelines(s_VulkanData.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &s_VulkanData.depthPrepassPipeline) != VK_SUCCESS, "Failed to create depth prepass Pipeline!")
+    s_VulkanData.successQueue.push_back("Depth prepass Pipeline successfully created!");
+
+    delete prepassShader;
+    prepassShader = nullptr;
+}
+
+// Usage of every depth buffer, imageless framebuffers have to be told it
+const VkImageUsageFlags DEPTH_IMAGE_USAGE = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+// One framebuffer for every color image of the given size and usage plus a depth buffer of the same size,
+// the views are only named when the render pass begins
+static VkFramebuffer CreateImagelessFramebuffer(VkRenderPass renderPass, VkExtent2D extent, VkImageUsageFlags usage)
+{
+    std::array<VkFramebufferAttachmentImageInfo, 2> attachmentImageInfos{};
+    for (VkFramebufferAttachmentImageInfo& attachmentImageInfo : attachmentImageInfos)
+    {
+        attachmentImageInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_ATTACHMENT_IMAGE_INFO;
+        attachmentImageInfo.width = extent.width;
+        attachmentImageInfo.height = extent.height;
+        attachmentImageInfo.layerCount = 1;
+        attachmentImageInfo.viewFormatCount = 1;
+    }
+    attachmentImageInfos[0].usage = usage; // Has to match the images' usage exactly
+    attachmentImageInfos[0].pViewFormats = &s_VulkanData.swapChainImageFormat;
+    attachmentImageInfos[1].usage = DEPTH_IMAGE_USAGE;
+    attachmentImageInfos[1].pViewFormats = &s_VulkanData.depthFormat;
+
+    VkFramebufferAttachmentsCreateInfo attachmentsInfo{};
+    attachmentsInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_ATTACHMENTS_CREATE_INFO;
+    attachmentsInfo.attachmentImageInfoCount = static_cast<uint32_t>(attachmentImageInfos.size());
+    attachmentsInfo.pAttachmentImageInfos = attachmentImageInfos.data();
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.pNext = &attachmentsInfo;
+    framebufferInfo.flags = VK_FRAMEBUFFER_CREATE_IMAGELESS_BIT;
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(attachmentImageInfos.size());
+    framebufferInfo.width = extent.width;
+    framebufferInfo.height = extent.height;
+    framebufferInfo.layers = 1;
+
+    VkFramebuffer framebuffer;
+    CheckForError(vkCreateFramebuffer(s_VulkanData.device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS, "Failed to create framebuffer!")
+    return framebuffer;
 }
 
 void VulkanRenderer::CreateFramebuffers()
 {                                                                                                                                                           
-    s_VulkanData.swapChainFramebuffers.resize(s_VulkanData.swapChainImageViews.size());                                                                   
-    s_VulkanData.successQueue.push_back("Image Views:" + std::to_string(s_VulkanData.swapChainImageViews.size()));
-                                                                                                                                                            
-        // Loop through each swap chain image view                                                                                                          
-        for (size_t i = 0; i < s_VulkanData.swapChainImageViews.size(); i++) {                                                                             
-            // Create an array of attachments containing the current swap chain image view                                                                  
-            VkImageView attachments[] = {                                                                                                                   
-                s_VulkanData.swapChainImageViews[i]                                                                                                        
-            };                                                                                                                                              
-                                                                                                                                                            
-            // Create a VkFramebufferCreateInfo struct for setting up a framebuffer                                                                         
-            VkFramebufferCreateInfo framebufferInfo{};                                                                                                      
-            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO; // Specify the type of the struct                                            
-            framebufferInfo.renderPass = s_VulkanData.renderPass; // Specify the render pass associated with this framebuffer                              
-            framebufferInfo.attachmentCount = 1; // Specify the number of attachments in the framebuffer                                                    
-            framebufferInfo.pAttachments = attachments; // Specify the array of attachments                                                                 
-            framebufferInfo.width = s_VulkanData.swapChainExtent.width; // Specify the width of the framebuffer                                            
-            framebufferInfo.height = s_VulkanData.swapChainExtent.height; // Specify the height of the framebuffer                                         
-            framebufferInfo.layers = 1; // Specify the number of layers in the framebuffer (1 for most cases)   
-
-            CheckForError(vkCreateFramebuffer(s_VulkanData.device, &framebufferInfo, nullptr, &s_VulkanData.swapChainFramebuffers[i]) != VK_SUCCESS, "Failed to create framebuffer!") 
-            s_VulkanData.successQueue.push_back("Framebuffer successfully created!");
-        }
+    if (s_VulkanData.renderingBackend != RenderingBackend::ImagelessFramebuffer)
+        return;
+
+    s_VulkanData.swapChainFramebuffer = CreateImagelessFramebuffer(s_VulkanData.renderPass, s_VulkanData.swapChainExtent, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+    s_VulkanData.successQueue.push_back("Framebuffer successfully created!");
 }
 
 void VulkanRenderer::CreateCommandPool()
@@ -651,6 +1281,7 @@ void VulkanRenderer::CreateCommandPool()
 void VulkanRenderer::CreateCommandBuffer()
 {                                                              
     s_VulkanData.commandBuffers.resize(MAX_FRAMES_IN_FLIGHT); 
+    s_VulkanData.sceneCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 
     // Create a VkCommandBufferAllocateInfo struct for allocating command buffers                                        
     VkCommandBufferAllocateInfo allocInfo{};                                                                             
@@ -662,6 +1293,7 @@ void VulkanRenderer::CreateCommandBuffer()
     // 'allocInfo' contains the information required to allocate a Vulkan command buffer                                 
                                                                                                                          
     CheckForError(vkAllocateCommandBuffers(s_VulkanData.device, &allocInfo, s_VulkanData.commandBuffers.data()) != VK_SUCCESS, "Failed to create Command Buffer!")
+    CheckForError(vkAllocateCommandBuffers(s_VulkanData.device, &allocInfo, s_VulkanData.sceneCommandBuffers.data()) != VK_SUCCESS, "Failed to create Command Buffer!")
     s_VulkanData.successQueue.push_back("Command Buffer successfully created!");
 }
 
@@ -694,7 +1326,7 @@ void VulkanRenderer::CreateSyncObjects()
     }
 }
 
-static uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
 {
     VkPhysicalDeviceMemoryProperties memProperties;
     vkGetPhysicalDeviceMemoryProperties(s_VulkanData.physicalDevice, &memProperties);
@@ -764,6 +1396,59 @@ void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
     vkFreeCommandBuffers(s_VulkanData.device, s_VulkanData.commandPool, 1, &commandBuffer);
 }
 
+static DepthBuffer CreateDepthBuffer(VkExtent2D extent)
+{
+    DepthBuffer depth;
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = s_VulkanData.depthFormat;
+    imageInfo.extent.width = extent.width;
+    imageInfo.extent.height = extent.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.mipLevels = 1;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = DEPTH_IMAGE_USAGE;
+
+    CheckForError(vkCreateImage(s_VulkanData.device, &imageInfo, nullptr, &depth.image) != VK_SUCCESS, "Failed to create depth Image!")
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(s_VulkanData.device, depth.image, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    CheckForError(vkAllocateMemory(s_VulkanData.device, &allocInfo, nullptr, &depth.memory) != VK_SUCCESS, "Failed to allocate depth Image Memory!")
+    vkBindImageMemory(s_VulkanData.device, depth.image, depth.memory, 0);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = depth.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = s_VulkanData.depthFormat;
+    viewInfo.subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 }; // findDepthFormat only picks formats without stencil
+
+    CheckForError(vkCreateImageView(s_VulkanData.device, &viewInfo, nullptr, &depth.view) != VK_SUCCESS, "Failed to create depth Image View!")
+    return depth;
+}
+
+static void DestroyDepthBuffer(VkDevice device, const DepthBuffer& depth)
+{
+    vkDestroyImageView(device, depth.view, nullptr);
+    vkDestroyImage(device, depth.image, nullptr);
+    vkFreeMemory(device, depth.memory, nullptr);
+}
+
+void VulkanRenderer::CreateDepthResources()
+{
+    s_VulkanData.swapChainDepth = CreateDepthBuffer(s_VulkanData.swapChainExtent);
+}
+
 void VulkanRenderer::CreateVertexBuffer()
 {
     VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
@@ -820,7 +1505,7 @@ void VulkanRenderer::CreateDescriptorSetLayout()
     layoutInfo.bindingCount = 1;
     layoutInfo.pBindings = &uboLayoutBinding;
 
-    CheckForError(vkCreateDescriptorSetLayout(s_VulkanData.device, &layoutInfo, nullptr, &s_VulkanData.descriptorSetLayout) != VK_SUCCESS, "Failed to create descriptor set layout!")
+    s_VulkanData.descriptorSetLayout = DescriptorAllocator::CreateSetLayout(s_VulkanData.device, layoutInfo);
 }
 
 void VulkanRenderer::CreateUniformBuffers()
@@ -838,437 +1523,1770 @@ void VulkanRenderer::CreateUniformBuffers()
     }
 }
 
-void VulkanRenderer::CreateDescriptorPool()
+void VulkanRenderer::UpdateUniformBuffer(uint32_t frameIndex)
 {
-    VkDescriptorPoolSize poolSize{};
-    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSize.descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    const Camera& camera = s_VulkanData.camera;
+    const Camera& uboCamera = s_VulkanData.uboCamera;
+    VkExtent2D extent = GetOutputExtent();
+    uint32_t allFrames = (1u << MAX_FRAMES_IN_FLIGHT) - 1;
+    bool initialized = s_VulkanData.uboInitialized;
+
+    // Rebuild the view only when the camera moved
+    if (!initialized || camera.position != uboCamera.position || camera.target != uboCamera.target || camera.up != uboCamera.up)
+    {
+        s_VulkanData.ubo.view = glm::lookAt(camera.position, camera.target, camera.up);
+        s_VulkanData.uniformDirtyFrames[UniformBlockView] = allFrames;
+    }
+
+    // Rebuild the projection only when the lens or the output extent changed, the aspect ratio is the output's
+    // even when dynamic resolution renders at a different size
+    if (!initialized || camera.fovY != uboCamera.fovY || camera.nearPlane != uboCamera.nearPlane || camera.farPlane != uboCamera.farPlane ||
+        extent.width != s_VulkanData.uboExtent.width || extent.height != s_VulkanData.uboExtent.height)
+    {
+        s_VulkanData.ubo.proj = glm::perspective(glm::radians(camera.fovY), (float)extent.width / (float)extent.height, camera.nearPlane, camera.farPlane);
+        s_VulkanData.ubo.proj[1][1] *= -1;
+        s_VulkanData.uniformDirtyFrames[UniformBlockProjection] = allFrames;
+    }
+
+    s_VulkanData.uboCamera = camera;
+    s_VulkanData.uboExtent = extent;
+    s_VulkanData.uboInitialized = true;
+
+    // Each frame in flight has its own buffer, copy only the blocks it has not received yet
+    const size_t blockOffsets[UniformBlockCount] = { offsetof(UniformBufferObject, view), offsetof(UniformBufferObject, proj) };
+    const size_t blockSizes[UniformBlockCount] = { sizeof(glm::mat4), sizeof(glm::mat4) };
 
-    VkDescriptorPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = 1;
-    poolInfo.pPoolSizes = &poolSize;
-    poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    uint8_t* mapped = static_cast<uint8_t*>(s_VulkanData.uniformBuffersMapped[frameIndex]);
+    uint32_t frameBit = 1u << frameIndex;
+    s_VulkanData.uniformBytesWritten = 0;
 
-    CheckForError(vkCreateDescriptorPool(s_VulkanData.device, &poolInfo, nullptr, &s_VulkanData.descriptorPool) != VK_SUCCESS, "Failed to create descriptor pool!")
+    for (uint32_t block = 0; block < UniformBlockCount; block++)
+    {
+        if ((s_VulkanData.uniformDirtyFrames[block] & frameBit) == 0)
+            continue;
+
+        memcpy(mapped + blockOffsets[block], reinterpret_cast<const uint8_t*>(&s_VulkanData.ubo) + blockOffsets[block], blockSizes[block]);
+        s_VulkanData.uniformDirtyFrames[block] &= ~frameBit;
+        s_VulkanData.uniformBytesWritten += static_cast<uint32_t>(blockSizes[block]);
+    }
 }
 
-void VulkanRenderer::CreateDescriptorSets()
+void VulkanRenderer::CreateDescriptorPool()
 {
-    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, s_VulkanData.descriptorSetLayout);
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = s_VulkanData.descriptorPool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-    allocInfo.pSetLayouts = layouts.data();
+    // Pools are created on demand and sized from what actually gets allocated
+    s_VulkanData.descriptorAllocator.Init(s_VulkanData.device, MAX_FRAMES_IN_FLIGHT);
+
+    s_VulkanData.frameDescriptorAllocators.resize(MAX_FRAMES_IN_FLIGHT);
+    for (DescriptorAllocator& allocator : s_VulkanData.frameDescriptorAllocators)
+        allocator.Init(s_VulkanData.device);
+}
 
+void VulkanRenderer::CreateDescriptorSets()
+{
     s_VulkanData.descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-    CheckForError(vkAllocateDescriptorSets(s_VulkanData.device, &allocInfo, s_VulkanData.descriptorSets.data()) != VK_SUCCESS, "Failed to allocate descriptor sets!")
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        s_VulkanData.descriptorSets[i] = s_VulkanData.descriptorAllocator.Allocate(s_VulkanData.descriptorSetLayout);
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-        {
-            VkDescriptorBufferInfo bufferInfo{};
-            bufferInfo.buffer = s_VulkanData.uniformBuffers[i];
-            bufferInfo.offset = 0;
-            bufferInfo.range = sizeof(UniformBufferObject);
-            
-            //VkDescriptorImageInfo imageInfo{};
-            //imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            //imageInfo.imageView = s_VulkanData.textureImageView;
-            //imageInfo.sampler = s_VulkanData.textureSampler;
-
-            VkWriteDescriptorSet descriptorWrite{};
-            descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrite.dstSet = s_VulkanData.descriptorSets[i];
-            descriptorWrite.dstBinding = 0;
-            descriptorWrite.dstArrayElement = 0;
-            descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            descriptorWrite.descriptorCount = 1;
-            descriptorWrite.pBufferInfo = &bufferInfo;
-            descriptorWrite.pImageInfo = nullptr; // Optional 
-            descriptorWrite.pTexelBufferView = nullptr; // Optional 
-
-            vkUpdateDescriptorSets(s_VulkanData.device, 1, &descriptorWrite, 0, nullptr);
-        }
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = s_VulkanData.uniformBuffers[i];
+        bufferInfo.offset = 0;
+        bufferInfo.range = sizeof(UniformBufferObject);
+
+        //VkDescriptorImageInfo imageInfo{};
+        //imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        //imageInfo.imageView = s_VulkanData.textureImageView;
+        //imageInfo.sampler = s_VulkanData.textureSampler;
+
+        VkWriteDescriptorSet descriptorWrite{};
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet = s_VulkanData.descriptorSets[i];
+        descriptorWrite.dstBinding = 0;
+        descriptorWrite.dstArrayElement = 0;
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.pBufferInfo = &bufferInfo;
+        descriptorWrite.pImageInfo = nullptr; // Optional
+        descriptorWrite.pTexelBufferView = nullptr; // Optional
+
+        vkUpdateDescriptorSets(s_VulkanData.device, 1, &descriptorWrite, 0, nullptr);
+    }
+}
+
+// Returns the index shaders use to look the material up in the materials buffer
+static uint32_t CreateMaterial(TextureHandle albedoTexture, const glm::vec4& baseColor, DrawPass pass = DrawPassOpaque, uint32_t pipeline = DEFAULT_PIPELINE)
+{
+    CheckForError(s_VulkanData.materialCount >= MAX_MATERIALS, "Material buffer is full!")
+
+    // The bindless slot stays the same while mips stream in and out, the material never has to be rewritten
+    GpuMaterial& material = s_VulkanData.materialsMapped[s_VulkanData.materialCount];
+    material.baseColor = baseColor;
+    material.albedoTexture = TextureManager::GetBindlessIndex(albedoTexture);
+    s_VulkanData.materialInfos.push_back({ pass, pipeline, albedoTexture });
 
+    return s_VulkanData.materialCount++;
 }
 
-VkCommandBuffer beginSingleTimeCommands()
+void VulkanRenderer::CreateMaterialBuffer()
 {
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = s_VulkanData.commandPool;
-    allocInfo.commandBufferCount = 1;
+    VkDeviceSize bufferSize = sizeof(GpuMaterial) * MAX_MATERIALS;
 
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(s_VulkanData.device, &allocInfo, &commandBuffer);
+    // Materials are written rarely and read through the bindless set, so the buffer stays mapped
+    CreateBuffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, s_VulkanData.materialBuffer, s_VulkanData.materialBufferMemory);
+    vkMapMemory(s_VulkanData.device, s_VulkanData.materialBufferMemory, 0, bufferSize, 0, reinterpret_cast<void**>(&s_VulkanData.materialsMapped));
 
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    s_VulkanData.materialBufferIndex = BindlessDescriptors::RegisterStorageBuffer(s_VulkanData.materialBuffer, 0, bufferSize);
+    CheckForError(s_VulkanData.materialBufferIndex != MATERIAL_BUFFER_BINDLESS_INDEX, "Materials buffer must take the first bindless storage buffer slot!")
 
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    // Vertex colors only, the albedo is the white placeholder
+    s_VulkanData.defaultMaterial = CreateMaterial(INVALID_TEXTURE, glm::vec4(1.0f));
 
-    return commandBuffer;
-}    
+    // Entity material, samples the placeholder until the file's mip tail is resident or if it fails to load
+    s_VulkanData.checkerMaterial = CreateMaterial(TextureManager::LoadTexture("Application/Textures/checker.ktx2"), glm::vec4(1.0f));
 
-void endSingleTimeCommands(VkCommandBuffer commandBuffer)
+    s_VulkanData.successQueue.push_back("Material Buffer successfully created!");
+}
+
+void VulkanRenderer::CreateInstanceBuffers()
 {
-    vkEndCommandBuffer(commandBuffer);
+    VkDeviceSize bufferSize = sizeof(glm::mat4) * (MAX_SCENE_INSTANCES + MAX_ENTITY_INSTANCES);
 
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
+    // Host visible and persistently mapped, only the matrices that changed since the frame's last use are copied in
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        CreateBuffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, s_VulkanData.instanceBuffers[i], s_VulkanData.instanceBuffersMemory[i]);
+        vkMapMemory(s_VulkanData.device, s_VulkanData.instanceBuffersMemory[i], 0, bufferSize, 0, &s_VulkanData.instanceBuffersMapped[i]);
+    }
 
-    vkQueueSubmit(s_VulkanData.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(s_VulkanData.graphicsQueue);
+    s_VulkanData.instanceBufferIndex = BindlessDescriptors::RegisterFrameStorageBuffers(s_VulkanData.instanceBuffers, bufferSize);
+    CheckForError(s_VulkanData.instanceBufferIndex != INSTANCE_BUFFER_BINDLESS_INDEX, "Instance buffers must take the second bindless storage buffer slot!")
 
-    vkFreeCommandBuffers(s_VulkanData.device, s_VulkanData.commandPool, 1, &commandBuffer);
+    s_VulkanData.successQueue.push_back("Instance Buffers successfully created!");
 }
 
-void VulkanRenderer::InitImGui()
+// Layout of the push constant block in meshlet_cull.comp
+struct MeshletCullConstants
 {
-    VkDescriptorPoolSize pool_sizes[] =
-    {
-        { VK_DESCRIPTOR_TYPE_SAMPLER, 1000 },
-        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000 },
-        { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1000 },
-        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1000 },
-        { VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1000 },
-        { VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1000 },
-        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000 },
-        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1000 },
-        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1000 },
-        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1000 },
-        { VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1000 }
-    };
+    glm::vec4 frustumPlanes[6];
+    glm::vec4 cameraPosition;
+    uint32_t meshletCount;
+};
 
-    // Create the descriptor pool
-    VkDescriptorPoolCreateInfo pool_info = {};
-    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT; // Adjust flags as needed
-    pool_info.maxSets = 1000; // Maximum number of descriptor sets
-    pool_info.poolSizeCount = static_cast<uint32_t>(sizeof(pool_sizes) / sizeof(pool_sizes[0]));
-    pool_info.pPoolSizes = pool_sizes;
+static void CreateDeviceLocalBuffer(const void* source, VkDeviceSize bufferSize, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+{
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
 
-    CheckForError(vkCreateDescriptorPool(s_VulkanData.device, &pool_info, nullptr, &s_VulkanData.imGuiDescriptorPool) != VK_SUCCESS, "Failed to create ImGui Descriptor Pool!")
-    
-    VkAttachmentDescription attachment = {};
-    attachment.format = s_VulkanData.swapChainImageFormat;
-    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
-    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL; 
-    attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    VkAttachmentReference color_attachment = {};
-    color_attachment.attachment = 0;
-    color_attachment.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass = {};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &color_attachment;
+    void* data;
+    vkMapMemory(s_VulkanData.device, stagingBufferMemory, 0, bufferSize, 0, &data);
+    memcpy(data, source, (size_t)bufferSize);
+    vkUnmapMemory(s_VulkanData.device, stagingBufferMemory);
 
-    VkSubpassDependency dependency = {};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;  // or VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT; 
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-    VkRenderPassCreateInfo info = {};
-    info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    info.attachmentCount = 1;
-    info.pAttachments = &attachment;
-    info.subpassCount = 1;
-    info.pSubpasses = &subpass;
-    info.dependencyCount = 1;
-    info.pDependencies = &dependency;
-    CheckForError(vkCreateRenderPass(s_VulkanData.device, &info, nullptr, &s_VulkanData.imGuiRenderPass) != VK_SUCCESS, "Failed to create ImGui Render Pass!")
-    
-    // Setup Dear ImGui context
-    IMGUI_CHECKVERSION(); 
-    ImGui::CreateContext();  
-    ImGuiIO& io = ImGui::GetIO(); (void)io; 
-    io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+    CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory);
+    CopyBuffer(stagingBuffer, buffer, bufferSize);
 
-    // Setup Dear ImGui style
-    ImGui::StyleColorsDark(); 
+    vkDestroyBuffer(s_VulkanData.device, stagingBuffer, nullptr);
+    vkFreeMemory(s_VulkanData.device, stagingBufferMemory, nullptr);
+}
 
-    // Setup Platform/Renderer bindings
-    ImGui_ImplGlfw_InitForVulkan(GetWindow().GLFW(), true);
-    ImGui_ImplVulkan_InitInfo init_info = {};
-    init_info.Instance = s_VulkanData.instance;
-    init_info.PhysicalDevice = s_VulkanData.physicalDevice;
-    init_info.Device = s_VulkanData.device;
-    init_info.QueueFamily = Utils::findQueueFamilies(s_VulkanData.physicalDevice, s_VulkanData.surface).graphicsFamily.value();
-    init_info.Queue = s_VulkanData.graphicsQueue;
-    init_info.PipelineCache = VK_NULL_HANDLE;
-    init_info.DescriptorPool = s_VulkanData.imGuiDescriptorPool;
-    init_info.Allocator = nullptr;
-    init_info.MinImageCount = s_VulkanData.swapChainImages.size();
-    init_info.ImageCount = s_VulkanData.swapChainImages.size(); 
-    ImGui_ImplVulkan_Init(&init_info, s_VulkanData.imGuiRenderPass);
+void VulkanRenderer::CreatePositionBuffer()
+{
+    // Same order as the vertex buffer, the index buffers work unchanged on it
+    std::vector<glm::vec2> positions;
+    positions.reserve(vertices.size());
+    for (const Vertex& vertex : vertices)
+        positions.push_back(vertex.pos);
+
+    CreateDeviceLocalBuffer(positions.data(), sizeof(glm::vec2) * positions.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        s_VulkanData.positionBuffer, s_VulkanData.positionBufferMemory);
+}
 
-    VkCommandBuffer command_buffer = beginSingleTimeCommands();   
-    ImGui_ImplVulkan_CreateFontsTexture(command_buffer);  
-    endSingleTimeCommands(command_buffer);  
+void VulkanRenderer::CreateMeshletBuffers()
+{
+    // The cull pass only needs positions, the vertex buffer itself is drawn unchanged
+    std::vector<glm::vec3> positions;
+    positions.reserve(vertices.size());
+    for (const Vertex& vertex : vertices)
+        positions.push_back(glm::vec3(vertex.pos, 0.0f));
 
-    /// Assumption 
-    
-    s_VulkanData.imGuiFramebuffers.resize(s_VulkanData.swapChainImageViews.size());
+    std::vector<uint32_t> meshIndices(indices.begin(), indices.end());
 
-    for (uint32_t i = 0; i < s_VulkanData.swapChainImageViews.size(); i++) 
-    {
-        VkImageView attachment[] = { s_VulkanData.swapChainImageViews[i] }; // Set the correct image view
+    MeshletData meshletData = MeshletBuilder::Build(positions, meshIndices);
 
-        VkFramebufferCreateInfo info = {};
-        info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        info.renderPass = s_VulkanData.imGuiRenderPass;
-        info.attachmentCount = 1;
-        info.pAttachments = attachment; // Attach the correct image view
-        info.width = s_VulkanData.swapChainExtent.width;
-        info.height = s_VulkanData.swapChainExtent.height;
-        info.layers = 1;
+    // The shader reads the uint8 triangle list as packed uints
+    meshletData.meshletTriangles.resize((meshletData.meshletTriangles.size() + 3) & ~size_t(3), 0);
 
-        CheckForError(vkCreateFramebuffer(s_VulkanData.device, &info, nullptr, &s_VulkanData.imGuiFramebuffers[i]) != VK_SUCCESS, "Failed to create ImGui Framebuffer!");
-    }
+    s_VulkanData.meshletCount = static_cast<uint32_t>(meshletData.meshlets.size());
+    s_VulkanData.meshletIndexCapacity = static_cast<uint32_t>(meshIndices.size());
 
+    CreateDeviceLocalBuffer(meshletData.meshlets.data(), sizeof(Meshlet) * meshletData.meshlets.size(),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, s_VulkanData.meshletBuffer, s_VulkanData.meshletBufferMemory);
+    CreateDeviceLocalBuffer(meshletData.meshletVertices.data(), sizeof(uint32_t) * meshletData.meshletVertices.size(),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, s_VulkanData.meshletVertexBuffer, s_VulkanData.meshletVertexBufferMemory);
+    CreateDeviceLocalBuffer(meshletData.meshletTriangles.data(), meshletData.meshletTriangles.size(),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, s_VulkanData.meshletTriangleBuffer, s_VulkanData.meshletTriangleBufferMemory);
 
-    VkCommandPoolCreateInfo commandPoolCreateInfo = {};
-    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    commandPoolCreateInfo.queueFamilyIndex = Utils::findQueueFamilies(s_VulkanData.physicalDevice, s_VulkanData.surface).graphicsFamily.value();
-    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    CheckForError(vkCreateCommandPool(s_VulkanData.device, &commandPoolCreateInfo, nullptr, &s_VulkanData.imGuiCommandPool) != VK_SUCCESS, "Could not create graphics ImGui Command Pool!")
+    s_VulkanData.compactedIndexBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    s_VulkanData.compactedIndexBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+    s_VulkanData.drawCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    s_VulkanData.drawCommandBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
 
-    VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
-    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    commandBufferAllocateInfo.commandPool = s_VulkanData.imGuiCommandPool;
-    commandBufferAllocateInfo.commandBufferCount = 1;
-    vkAllocateCommandBuffers(s_VulkanData.device, &commandBufferAllocateInfo, &s_VulkanData.imGuiCommandBuffer);
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        // Worst case every cluster survives, so the compacted list is never larger than the source index list
+        CreateBuffer(sizeof(uint32_t) * s_VulkanData.meshletIndexCapacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, s_VulkanData.compactedIndexBuffers[i], s_VulkanData.compactedIndexBuffersMemory[i]);
 
-    CreateViewportTextureSampler(); 
+        CreateBuffer(sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, s_VulkanData.drawCommandBuffers[i], s_VulkanData.drawCommandBuffersMemory[i]);
+    }
+
+    s_VulkanData.successQueue.push_back("Meshlets built: " + std::to_string(s_VulkanData.meshletCount));
 }
 
-void VulkanRenderer::CreateViewportImages()
+void VulkanRenderer::CreateMeshletCullPipeline()
 {
-    s_VulkanData.viewportImages.resize(s_VulkanData.swapChainImages.size()); 
-    s_VulkanData.imageMemory.resize(s_VulkanData.swapChainImages.size());
-
-    for (uint32_t i = 0; i < s_VulkanData.swapChainImages.size(); i++)
+    // Bindings 0-2 hold the static meshlet data, 3 the compacted index output and 4 the indirect draw arguments
+    std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++)
     {
-        VkImageCreateInfo imageInfo{};
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    s_VulkanData.meshletCullSetLayout = DescriptorAllocator::CreateSetLayout(s_VulkanData.device, layoutInfo);
+
+    s_VulkanData.meshletCullDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        s_VulkanData.meshletCullDescriptorSets[i] = s_VulkanData.descriptorAllocator.Allocate(s_VulkanData.meshletCullSetLayout);
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        std::array<VkDescriptorBufferInfo, 5> bufferInfos{};
+        bufferInfos[0] = { s_VulkanData.meshletBuffer, 0, VK_WHOLE_SIZE };
+        bufferInfos[1] = { s_VulkanData.meshletVertexBuffer, 0, VK_WHOLE_SIZE };
+        bufferInfos[2] = { s_VulkanData.meshletTriangleBuffer, 0, VK_WHOLE_SIZE };
+        bufferInfos[3] = { s_VulkanData.compactedIndexBuffers[i], 0, VK_WHOLE_SIZE };
+        bufferInfos[4] = { s_VulkanData.drawCommandBuffers[i], 0, VK_WHOLE_SIZE };
+
+        std::array<VkWriteDescriptorSet, 5> descriptorWrites{};
+        for (uint32_t binding = 0; binding < descriptorWrites.size(); binding++)
+        {
+            descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[binding].dstSet = s_VulkanData.meshletCullDescriptorSets[i];
+            descriptorWrites[binding].dstBinding = binding;
+            descriptorWrites[binding].dstArrayElement = 0;
+            descriptorWrites[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[binding].descriptorCount = 1;
+            descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+        }
+
+        vkUpdateDescriptorSets(s_VulkanData.device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(MeshletCullConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &s_VulkanData.meshletCullSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    CheckForError(vkCreatePipelineLayout(s_VulkanData.device, &pipelineLayoutInfo, nullptr, &s_VulkanData.meshletCullPipelineLayout) != VK_SUCCESS, "Failed to create meshlet cull Pipeline Layout!")
+
+    Shader* shader = new Shader("Application/Shaders/meshlet_cull.spv");
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = shader->GetShaderStages()[0];
+    pipelineInfo.layout = s_VulkanData.meshletCullPipelineLayout;
+
+    CheckForError(vkCreateComputePipelines(s_VulkanData.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &s_VulkanData.meshletCullPipeline) != VK_SUCCESS, "Failed to create meshlet cull Pipeline!")
+    s_VulkanData.successQueue.push_back("Meshlet cull Pipeline successfully created!");
+
+    delete shader;
+    shader = nullptr;
+}
+
+void VulkanRenderer::CreateUpscalePipeline()
+{
+    // Bilinear for both upscalers, the edge adaptive one sharpens on top of it
+    SamplerDescription samplerDescription{};
+    samplerDescription.magFilter = VK_FILTER_LINEAR;
+    samplerDescription.minFilter = VK_FILTER_LINEAR;
+    samplerDescription.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerDescription.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerDescription.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerDescription.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerDescription.maxAnisotropy = 1.0f;
+    samplerDescription.minLod = 0.0f;
+    samplerDescription.maxLod = VK_LOD_CLAMP_NONE;
+    s_VulkanData.upscaleSampler = SamplerCache::GetSampler(samplerDescription);
+
+    VkDescriptorSetLayoutBinding sourceBinding{};
+    sourceBinding.binding = 0;
+    sourceBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    sourceBinding.descriptorCount = 1;
+    sourceBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &sourceBinding;
+
+    s_VulkanData.upscaleSetLayout = DescriptorAllocator::CreateSetLayout(s_VulkanData.device, layoutInfo);
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(UpscaleConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &s_VulkanData.upscaleSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    CheckForError(vkCreatePipelineLayout(s_VulkanData.device, &pipelineLayoutInfo, nullptr, &s_VulkanData.upscalePipelineLayout) != VK_SUCCESS, "Failed to create upscale Pipeline Layout!")
+
+    Shader* shader = new Shader("Application/Shaders/upscale_vert.spv", "Application/Shaders/upscale_frag.spv");
+
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    // The full screen triangle comes from the vertex index, there are no vertex buffers
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    // Render passes always have a depth attachment, the upscale leaves it alone
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+
+    // Built for the swapchain's pass, which the offscreen pass is compatible with. With dynamic rendering it
+    // declares the depth format as well, every pass has its depth buffer attached.
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = static_cast<uint32_t>(shader->GetShaderStages().size());
+    pipelineInfo.pStages = shader->GetShaderStages().data();
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = s_VulkanData.upscalePipelineLayout;
+    pipelineInfo.renderPass = s_VulkanData.renderPass;
+    pipelineInfo.subpass = 0;
+
+    VkPipelineRenderingCreateInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &s_VulkanData.swapChainImageFormat;
+    renderingInfo.depthAttachmentFormat = s_VulkanData.depthFormat;
+    if (s_VulkanData.renderingBackend == RenderingBackend::DynamicRendering)
+        pipelineInfo.pNext = &renderingInfo;
+
+    CheckForError(vkCreateGraphicsPipelines(s_VulkanData.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &s_VulkanData.upscalePipeline) != VK_SUCCESS, "Failed to create upscale Pipeline!")
+    s_VulkanData.successQueue.push_back("Upscale Pipeline successfully created!");
+
+    delete shader;
+    shader = nullptr;
+}
+
+void VulkanRenderer::CreateTimestampQueries()
+{
+    // Dynamic resolution falls back to a fixed scale without them
+    if (s_VulkanData.timestampPeriod == 0.0)
+        return;
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = 2 * MAX_FRAMES_IN_FLIGHT;
+
+    CheckForError(vkCreateQueryPool(s_VulkanData.device, &queryPoolInfo, nullptr, &s_VulkanData.timestampQueryPool) != VK_SUCCESS, "Failed to create timestamp Query Pool!")
+}
+
+VkCommandBuffer beginSingleTimeCommands()
+{
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = s_VulkanData.commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    vkAllocateCommandBuffers(s_VulkanData.device, &allocInfo, &commandBuffer);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    return commandBuffer;
+}    
+
+void endSingleTimeCommands(VkCommandBuffer commandBuffer)
+{
+    vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    vkQueueSubmit(s_VulkanData.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    vkQueueWaitIdle(s_VulkanData.graphicsQueue);
+
+    vkFreeCommandBuffers(s_VulkanData.device, s_VulkanData.commandPool, 1, &commandBuffer);
+}
+
+void VulkanRenderer::InitImGui()
+{
+    // The ImGui backend only allocates one combined image sampler set per displayed texture (font atlas, viewport)
+    // and frees them individually, so it keeps a small dedicated pool instead of the shared allocators
+    VkDescriptorPoolSize pool_sizes[] =
+    {
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, IMGUI_MAX_TEXTURES }
+    };
+
+    // Create the descriptor pool
+    VkDescriptorPoolCreateInfo pool_info = {};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT; // Adjust flags as needed
+    pool_info.maxSets = IMGUI_MAX_TEXTURES; // Maximum number of descriptor sets
+    pool_info.poolSizeCount = static_cast<uint32_t>(sizeof(pool_sizes) / sizeof(pool_sizes[0]));
+    pool_info.pPoolSizes = pool_sizes;
+
+    CheckForError(vkCreateDescriptorPool(s_VulkanData.device, &pool_info, nullptr, &s_VulkanData.imGuiDescriptorPool) != VK_SUCCESS, "Failed to create ImGui Descriptor Pool!")
+    
+    // Setup Dear ImGui context
+    IMGUI_CHECKVERSION(); 
+    ImGui::CreateContext();  
+    ImGuiIO& io = ImGui::GetIO(); (void)io; 
+    io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+
+    // Setup Dear ImGui style
+    ImGui::StyleColorsDark(); 
+
+    // Setup Platform/Renderer bindings
+    ImGui_ImplGlfw_InitForVulkan(GetWindow().GLFW(), true);
+    ImGui_ImplVulkan_InitInfo init_info = {};
+    init_info.Instance = s_VulkanData.instance;
+    init_info.PhysicalDevice = s_VulkanData.physicalDevice;
+    init_info.Device = s_VulkanData.device;
+    init_info.QueueFamily = Utils::findQueueFamilies(s_VulkanData.physicalDevice, s_VulkanData.surface).graphicsFamily.value();
+    init_info.Queue = s_VulkanData.graphicsQueue;
+    init_info.PipelineCache = VK_NULL_HANDLE;
+    init_info.DescriptorPool = s_VulkanData.imGuiDescriptorPool;
+    init_info.Allocator = nullptr;
+    init_info.MinImageCount = s_VulkanData.swapChainImages.size();
+    init_info.ImageCount = s_VulkanData.swapChainImages.size(); 
+    // The UI is drawn at the end of the scene's render pass, so its pipeline is built for that pass. Under dynamic
+    // rendering it declares the pass's formats, depth included.
+    init_info.RenderPass = s_VulkanData.renderPass;
+#ifdef IMGUI_IMPL_VULKAN_HAS_DYNAMIC_RENDERING
+    init_info.UseDynamicRendering = s_VulkanData.renderingBackend == RenderingBackend::DynamicRendering;
+    init_info.PipelineRenderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    init_info.PipelineRenderingCreateInfo.colorAttachmentCount = 1;
+    init_info.PipelineRenderingCreateInfo.pColorAttachmentFormats = &s_VulkanData.swapChainImageFormat;
+    init_info.PipelineRenderingCreateInfo.depthAttachmentFormat = s_VulkanData.depthFormat;
+#endif
+    ImGui_ImplVulkan_Init(&init_info);
+
+    // Uploads through its own command buffer
+    ImGui_ImplVulkan_CreateFontsTexture();
+
+    CreateViewportTextureSampler(); 
+
+    // Starts out at the window's size, the panel's real size is known after its first frame
+    ResizeViewport(s_VulkanData.swapChainExtent.width, s_VulkanData.swapChainExtent.height);
+}
+
+// Every offscreen target is written as a color attachment and sampled afterwards, views and framebuffers must match
+const VkImageUsageFlags OFFSCREEN_IMAGE_USAGE = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+static void CreateOffscreenTargets(OffscreenTargets& targets, VkExtent2D extent)
+{
+    targets.extent = extent;
+    targets.images.resize(MAX_FRAMES_IN_FLIGHT); 
+    targets.memory.resize(MAX_FRAMES_IN_FLIGHT);
+    targets.views.resize(MAX_FRAMES_IN_FLIGHT);
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        // Same format as the swapchain, so the scene's pipelines render into either without rebuilding them.
+        // Only ever touched by the GPU, optimal tiling lets it lay the pixels out for rendering and sampling.
+        VkImageCreateInfo imageInfo{};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO; 
         imageInfo.imageType = VK_IMAGE_TYPE_2D; 
-        imageInfo.format = VK_FORMAT_B8G8R8A8_SRGB; 
-        imageInfo.extent.width = s_VulkanData.swapChainExtent.width; 
-        imageInfo.extent.height = s_VulkanData.swapChainExtent.height; 
+        imageInfo.format = s_VulkanData.swapChainImageFormat; 
+        imageInfo.extent.width = extent.width; 
+        imageInfo.extent.height = extent.height; 
         imageInfo.extent.depth = 1;  
         imageInfo.arrayLayers = 1;  
         imageInfo.mipLevels = 1; 
         imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; 
         imageInfo.samples = VK_SAMPLE_COUNT_1_BIT; 
-        imageInfo.tiling = VK_IMAGE_TILING_LINEAR; 
-        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT; 
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL; 
+        imageInfo.usage = OFFSCREEN_IMAGE_USAGE; 
+
+        CheckForError(vkCreateImage(s_VulkanData.device, &imageInfo, nullptr, &targets.images[i]) != VK_SUCCESS, "Failed to create Image!");
+
+        VkMemoryRequirements memRequirements; 
+        vkGetImageMemoryRequirements(s_VulkanData.device, targets.images[i], &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo{} ;
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO; 
+        allocInfo.allocationSize = memRequirements.size; 
+        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT); 
+        CheckForError(vkAllocateMemory(s_VulkanData.device, &allocInfo, nullptr, &targets.memory[i]) != VK_SUCCESS, "Failed to allocate Image Memory!")
+        vkBindImageMemory(s_VulkanData.device, targets.images[i], targets.memory[i], 0);
+
+        VkImageViewCreateInfo createInfo{}; 
+        createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO; 
+        createInfo.image = targets.images[i];  
+        createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D; 
+        createInfo.format = s_VulkanData.swapChainImageFormat;    
+        createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT; 
+        createInfo.subresourceRange.baseMipLevel = 0;   
+        createInfo.subresourceRange.levelCount = 1;  
+        createInfo.subresourceRange.baseArrayLayer = 0;  
+        createInfo.subresourceRange.layerCount = 1; 
+
+        CheckForError(vkCreateImageView(s_VulkanData.device, &createInfo, nullptr, &targets.views[i]) != VK_SUCCESS, "Failed to create offscreen Image Views!");
+    }
+
+    targets.depth = CreateDepthBuffer(extent);
+
+    if (s_VulkanData.renderingBackend == RenderingBackend::ImagelessFramebuffer)
+        targets.framebuffer = CreateImagelessFramebuffer(s_VulkanData.offscreenRenderPass, extent, OFFSCREEN_IMAGE_USAGE);
+}
+
+// Hands the targets to deferred destruction and leaves them empty, frames in flight may still render into or
+// sample them. 'textures' are descriptor sets from the ImGui pool showing them, freed along with them.
+static void RetireOffscreenTargets(OffscreenTargets& targets, std::vector<VkDescriptorSet>* textures = nullptr)
+{
+    if (targets.images.empty())
+        return;
+
+    VkDevice device = s_VulkanData.device;
+    VkDescriptorPool descriptorPool = s_VulkanData.imGuiDescriptorPool;
+    std::vector<VkDescriptorSet> retiredTextures;
+    if (textures)
+        retiredTextures = std::move(*textures);
+    OffscreenTargets retired = std::move(targets);
+
+    DeferDestruction([=]()
+    {
+        // The ImGui pool allows freeing sets one by one
+        if (!retiredTextures.empty())
+            vkFreeDescriptorSets(device, descriptorPool, static_cast<uint32_t>(retiredTextures.size()), retiredTextures.data());
+
+        vkDestroyFramebuffer(device, retired.framebuffer, nullptr);
+        DestroyDepthBuffer(device, retired.depth);
+        for (size_t i = 0; i < retired.images.size(); i++)
+        {
+            vkDestroyImageView(device, retired.views[i], nullptr);
+            vkDestroyImage(device, retired.images[i], nullptr);
+            vkFreeMemory(device, retired.memory[i], nullptr);
+        }
+    });
+
+    targets = OffscreenTargets{};
+    if (textures)
+        textures->clear();
+}
+
+void VulkanRenderer::CreateOffscreenRenderPass()
+{
+    if (s_VulkanData.renderingBackend != RenderingBackend::ImagelessFramebuffer)
+        return;
+
+    // Compatible with the scene's render pass, the same color and depth formats, so its pipelines work in both.
+    // Only the final layout differs, the target ends up ready to be sampled.
+    VkAttachmentDescription colorAttachment{}; 
+    colorAttachment.format = s_VulkanData.swapChainImageFormat;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkAttachmentReference colorAttachmentRef{};
+    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, DepthAttachmentDescription() };
+
+    VkAttachmentReference depthAttachmentRef{};
+    depthAttachmentRef.attachment = 1;
+    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachmentRef;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+    std::array<VkSubpassDependency, 2> dependencies{};
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    // The upscale or the UI samples the target later in the same command buffer
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassInfo.pDependencies = dependencies.data();
+
+    CheckForError(vkCreateRenderPass(s_VulkanData.device, &renderPassInfo, nullptr, &s_VulkanData.offscreenRenderPass) != VK_SUCCESS, "Failed to create offscreen Render Pass!")
+    s_VulkanData.successQueue.push_back("Offscreen Render Pass successfully created!");
+}
+
+void VulkanRenderer::CreateViewportTextures()
+{
+    const std::vector<VkImageView>& views = s_VulkanData.viewportTargets.views;
+    s_VulkanData.viewportTextures.resize(views.size());
+
+    for (size_t i = 0; i < views.size(); i++)
+        s_VulkanData.viewportTextures[i] = ImGui_ImplVulkan_AddTexture(s_VulkanData.textureSampler, views[i], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+void VulkanRenderer::ResizeViewport(uint32_t width, uint32_t height)
+{
+    // Nothing waits for the GPU, the old targets are destroyed once no frame in flight can use them
+    RetireOffscreenTargets(s_VulkanData.viewportTargets, &s_VulkanData.viewportTextures);
+
+    CreateOffscreenTargets(s_VulkanData.viewportTargets, { width, height });
+    s_VulkanData.viewportRequestedExtent = s_VulkanData.viewportTargets.extent;
+    CreateViewportTextures();
+}
+
+void VulkanRenderer::CreateViewportTextureSampler() 
+{
+    // Shared through the sampler cache, every other user of the same description gets this exact sampler.
+    // Clamped, the viewport target is stretched over the panel while a resize settles and must not wrap.
+    SamplerDescription samplerDescription{};
+    samplerDescription.magFilter = VK_FILTER_LINEAR;
+    samplerDescription.minFilter = VK_FILTER_LINEAR;
+    samplerDescription.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerDescription.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerDescription.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerDescription.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerDescription.maxAnisotropy = 1.0f;
+    samplerDescription.minLod = 0.0f;
+    samplerDescription.maxLod = VK_LOD_CLAMP_NONE;
+
+    s_VulkanData.textureSampler = SamplerCache::GetSampler(samplerDescription);
+}
+
+// Lays entities out on a square grid around the quad, a stress test for extraction
+static void SpawnEntityGrid(EntityRegistry& entities, uint32_t count)
+{
+    uint32_t side = static_cast<uint32_t>(glm::ceil(glm::sqrt(static_cast<float>(count))));
+    float spacing = 4.0f / side;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        Transform transform;
+        transform.position = glm::vec3((i % side) * spacing - 2.0f, (i / side) * spacing - 2.0f, -0.5f);
+        transform.scale = glm::vec3(spacing * 0.8f);
+
+        entities.Create(transform, MeshRef{ QUAD_MESH }, MaterialRef{ s_VulkanData.checkerMaterial }, Bounds{ glm::vec4(0.0f, 0.0f, 0.0f, 0.7072f) });
+    }
+}
+
+EntityRegistry& VulkanRenderer::GetEntities()
+{
+    return s_VulkanData.entities;
+}
+
+static void PostSimulationCommand(std::function<void(EntityRegistry&)> command)
+{
+    std::lock_guard<std::mutex> lock(s_VulkanData.simulationCommandsMutex);
+    s_VulkanData.simulationCommands.push_back(std::move(command));
+}
+
+void VulkanRenderer::BeginSimulationStep()
+{
+    std::vector<std::function<void(EntityRegistry&)>> commands;
+    {
+        std::lock_guard<std::mutex> lock(s_VulkanData.simulationCommandsMutex);
+        commands.swap(s_VulkanData.simulationCommands);
+    }
+
+    for (auto& command : commands)
+        command(s_VulkanData.entities);
+}
+
+void VulkanRenderer::PublishSnapshot(uint64_t simulationFrame, double simulationTime)
+{
+    FrameSnapshot& snapshot = s_VulkanData.snapshots.GetWriteSnapshot();
+    snapshot.simulationFrame = simulationFrame;
+    snapshot.simulationTime = simulationTime;
+
+    // The slot is reused, its vectors keep their capacity so steady state copies never allocate
+    snapshot.transforms.clear();
+    snapshot.meshes.clear();
+    snapshot.materials.clear();
+    snapshot.bounds.clear();
+
+    s_VulkanData.entities.ForEachChunk<Transform, MeshRef, MaterialRef, Bounds>(
+        [&snapshot](uint32_t count, const Entity*, const Transform* transforms, const MeshRef* meshes, const MaterialRef* materials, const Bounds* bounds)
+    {
+        snapshot.transforms.insert(snapshot.transforms.end(), transforms, transforms + count);
+        snapshot.meshes.insert(snapshot.meshes.end(), meshes, meshes + count);
+        snapshot.materials.insert(snapshot.materials.end(), materials, materials + count);
+        snapshot.bounds.insert(snapshot.bounds.end(), bounds, bounds + count);
+    });
+
+    // Interpolation pairs entities by position in the arrays, which only holds while the structure is unchanged
+    uint64_t structure = s_VulkanData.entities.GetStructureVersion();
+    bool structureChanged = structure != s_VulkanData.lastPublishedStructure;
+    if (!structureChanged)
+        snapshot.previousTransforms.swap(s_VulkanData.lastPublishedTransforms);
+    else
+        snapshot.previousTransforms = snapshot.transforms;
+
+    s_VulkanData.lastPublishedTransforms = snapshot.transforms;
+    s_VulkanData.lastPublishedStructure = structure;
+
+    // A step that moved nothing looks exactly like the one before it, on-demand rendering has nothing to redraw
+    snapshot.changed = structureChanged ||
+        memcmp(snapshot.previousTransforms.data(), snapshot.transforms.data(), snapshot.transforms.size() * sizeof(Transform)) != 0;
+
+    bool changed = snapshot.changed;
+    s_VulkanData.snapshots.Publish();
+
+    if (changed)
+        GetWindow().Invalidate();
+}
+
+uint32_t VulkanRenderer::GetDefaultMaterial()
+{
+    return s_VulkanData.defaultMaterial;
+}
+
+void VulkanRenderer::SetPresentPolicy(PresentPolicy policy)
+{
+    if (policy == s_VulkanData.presentPolicy)
+        return;
+
+    s_VulkanData.presentPolicy = policy;
+    s_VulkanData.swapChainSettingsChanged = true;
+    s_VulkanData.inputToPresentLatency = 0.0;
+    GetWindow().Invalidate();
+}
+
+PresentPolicy VulkanRenderer::GetPresentPolicy()
+{
+    return s_VulkanData.presentPolicy;
+}
+
+void VulkanRenderer::SetSwapchainImageCount(uint32_t imageCount)
+{
+    if (imageCount == s_VulkanData.requestedImageCount)
+        return;
+
+    s_VulkanData.requestedImageCount = imageCount;
+    s_VulkanData.swapChainSettingsChanged = true;
+    s_VulkanData.inputToPresentLatency = 0.0;
+    GetWindow().Invalidate();
+}
+
+double VulkanRenderer::GetInputToPresentLatency()
+{
+    return s_VulkanData.inputToPresentLatency;
+}
+
+void VulkanRenderer::SetDynamicResolution(bool enabled)
+{
+    s_VulkanData.EnableDynamicResolution = enabled;
+    s_VulkanData.resolutionScale = s_VulkanData.maxResolutionScale;
+    GetWindow().Invalidate();
+}
+
+void VulkanRenderer::SetResolutionScaleBounds(float minScale, float maxScale)
+{
+    s_VulkanData.minResolutionScale = glm::clamp(minScale, MIN_RESOLUTION_SCALE, 1.0f);
+    s_VulkanData.maxResolutionScale = glm::clamp(maxScale, s_VulkanData.minResolutionScale, 1.0f);
+    GetWindow().Invalidate();
+}
+
+void VulkanRenderer::SetUpscaler(Upscaler upscaler)
+{
+    s_VulkanData.upscaler = upscaler;
+    GetWindow().Invalidate();
+}
+
+float VulkanRenderer::GetResolutionScale()
+{
+    return s_VulkanData.EnableDynamicResolution ? s_VulkanData.resolutionScale : 1.0f;
+}
+
+// Time a frame may take, the frame rate cap if there is one, otherwise the display's refresh interval
+static double GetFrameBudget()
+{
+    double targetFrameRate = FrameTiming::GetTargetFrameRate();
+    return targetFrameRate > 0.0 ? 1.0 / targetFrameRate : s_VulkanData.refreshInterval;
+}
+
+// Picks up the GPU time of the last frame that ran in this slot, false if it wrote no timestamps
+static bool ReadGpuSceneTime()
+{
+    if (!s_VulkanData.timestampsWritten[currentFrame])
+        return false;
+
+    s_VulkanData.timestampsWritten[currentFrame] = false;
+
+    // The slot's fence has signaled, so the results are there without waiting
+    uint64_t timestamps[2];
+    VkResult result = vkGetQueryPoolResults(s_VulkanData.device, s_VulkanData.timestampQueryPool, currentFrame * 2, 2,
+        sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS || timestamps[1] < timestamps[0])
+        return false;
+
+    s_VulkanData.gpuSceneTime = static_cast<double>(timestamps[1] - timestamps[0]) * s_VulkanData.timestampPeriod * 1e-9;
+    return true;
+}
+
+// Moves the scale towards the one that would have made the measured frame fit the budget. The scene's cost
+// grows with its pixel count, the square of the per axis scale.
+static void UpdateResolutionScale(double gpuSceneTime)
+{
+    double target = GetFrameBudget() * DYNAMIC_RESOLUTION_HEADROOM;
+    if (gpuSceneTime <= 0.0 || std::abs(gpuSceneTime - target) < RESOLUTION_SCALE_DEADBAND * target)
+        return;
+
+    float& scale = s_VulkanData.resolutionScale;
+    float predicted = scale * static_cast<float>(std::sqrt(target / gpuSceneTime));
+    float rate = predicted < scale ? RESOLUTION_SCALE_DOWN_RATE : RESOLUTION_SCALE_UP_RATE;
+    scale += rate * (predicted - scale);
+}
+
+// Sizes the scene color targets to the output and picks this frame's render extent inside them
+static void UpdateDynamicResolution(bool measured)
+{
+    if (!s_VulkanData.EnableDynamicResolution)
+    {
+        RetireOffscreenTargets(s_VulkanData.sceneColorTargets);
+        return;
+    }
+
+    VkExtent2D output = GetOutputExtent();
+    float maxScale = s_VulkanData.maxResolutionScale;
+    VkExtent2D capacity = { std::max(1u, static_cast<uint32_t>(std::ceil(output.width * maxScale))), std::max(1u, static_cast<uint32_t>(std::ceil(output.height * maxScale))) };
+
+    OffscreenTargets& targets = s_VulkanData.sceneColorTargets;
+    if (capacity.width != targets.extent.width || capacity.height != targets.extent.height)
+    {
+        RetireOffscreenTargets(targets);
+        CreateOffscreenTargets(targets, capacity);
+    }
+
+    if (s_VulkanData.timestampPeriod == 0.0)
+        s_VulkanData.resolutionScale = maxScale;
+    else if (measured)
+        UpdateResolutionScale(s_VulkanData.gpuSceneTime);
+
+    float scale = glm::clamp(s_VulkanData.resolutionScale, s_VulkanData.minResolutionScale, maxScale);
+    s_VulkanData.resolutionScale = scale;
+    s_VulkanData.sceneRenderExtent = {
+        glm::clamp(static_cast<uint32_t>(std::round(output.width * scale)), 1u, capacity.width),
+        glm::clamp(static_cast<uint32_t>(std::round(output.height * scale)), 1u, capacity.height)
+    };
+}
+
+// The present call returns once the image is queued, not when it is on screen. Without present timing
+// extensions the rest of the wait is estimated from the present mode and refresh rate.
+static double EstimateScanoutDelay()
+{
+    double refresh = s_VulkanData.refreshInterval;
+    switch (s_VulkanData.presentMode)
+    {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        return 0.0;
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+        return 0.5 * refresh; // Replaces whatever is queued, waits for the next vblank on average half a refresh away
+    default:
+    {
+        // FIFO queues up to every image but the one on screen once the GPU runs ahead of the display
+        uint32_t queued = std::min<uint32_t>(static_cast<uint32_t>(s_VulkanData.swapChainImages.size()) - 1, MAX_FRAMES_IN_FLIGHT);
+        return (queued - 0.5) * refresh;
+    }
+    }
+}
+
+static const char* PresentModeName(VkPresentModeKHR mode)
+{
+    switch (mode)
+    {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:    return "Immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR:      return "Mailbox";
+    case VK_PRESENT_MODE_FIFO_KHR:         return "FIFO";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO relaxed";
+    default:                               return "Unknown";
+    }
+}
+
+void VulkanRenderer::ImGuiOnUpdate(uint32_t imageIndex)   
+{
+    ImGui_ImplVulkan_NewFrame(); 
+    ImGui_ImplGlfw_NewFrame(); 
+    ImGui::NewFrame(); 
+    //ImGui::DockSpaceOverViewport(ImGui::GetMainViewport());
+    
+
+    // A focused text field keeps drawing in on-demand mode, see VulkanRenderer::OnUpdate
+    s_VulkanData.uiTextInputActive = ImGui::GetIO().WantTextInput;
+
+    ImGui::Begin("Vulkan Renderer"); 
+
+    TextureStats textureStats = TextureManager::GetStats();
+    ImGui::Text("Textures: %u (%u reads, %u uploads pending)", textureStats.textureCount, textureStats.pendingReads, textureStats.pendingUploads);
+    ImGui::Text("Texture memory: %.1f / %.1f MB", textureStats.residentBytes / (1024.0f * 1024.0f), textureStats.budgetBytes / (1024.0f * 1024.0f));
+    ImGui::Text("Samplers: %u", SamplerCache::GetSamplerCount());
+    ImGui::Text("Uniform bytes written: %u", s_VulkanData.uniformBytesWritten);
+
+    ImGui::Text("Scene nodes: %u (%u updated)", s_VulkanData.scene.GetNodeCount(), s_VulkanData.scene.GetUpdatedNodeCount());
+    ImGui::Text("Simulation frame: %llu (interpolation %.2f)", static_cast<unsigned long long>(s_VulkanData.renderedSimulationFrame), s_VulkanData.interpolationAlpha);
+
+    const char* policyNames[] = { "Low latency", "Power saving", "Adaptive" };
+    int policy = static_cast<int>(s_VulkanData.presentPolicy);
+    if (ImGui::Combo("Present policy", &policy, policyNames, IM_ARRAYSIZE(policyNames)))
+        VulkanRenderer::SetPresentPolicy(static_cast<PresentPolicy>(policy));
+
+    int imageCount = static_cast<int>(s_VulkanData.requestedImageCount);
+    if (ImGui::SliderInt("Swapchain images (0 = auto)", &imageCount, 0, 4))
+        VulkanRenderer::SetSwapchainImageCount(static_cast<uint32_t>(imageCount));
+
+    ImGui::Text("Rendering backend: %s", RenderingBackendName(s_VulkanData.renderingBackend));
+    ImGui::Text("Present mode: %s, %zu images", PresentModeName(s_VulkanData.presentMode), s_VulkanData.swapChainImages.size());
+    ImGui::Text("Input to present: %.1f ms (%.1f ms of it estimated scanout wait)", s_VulkanData.inputToPresentLatency * 1000.0, EstimateScanoutDelay() * 1000.0);
+
+    bool onDemand = GetWindow().IsOnDemandRendering();
+    if (ImGui::Checkbox("On-demand rendering", &onDemand))
+        GetWindow().SetOnDemandRendering(onDemand);
+    ImGui::SameLine();
+    ImGui::Checkbox("Animate quad", &s_VulkanData.animateQuad);
+    ImGui::Checkbox("Render scene into viewport panel", &s_VulkanData.EnableViewport);
+    ImGui::SameLine();
+    ImGui::Text("(%u x %u)", GetOutputExtent().width, GetOutputExtent().height);
+
+    if (ImGui::CollapsingHeader("Dynamic resolution"))
+    {
+        bool dynamicResolution = s_VulkanData.EnableDynamicResolution;
+        if (ImGui::Checkbox("Enabled", &dynamicResolution))
+            VulkanRenderer::SetDynamicResolution(dynamicResolution);
+
+        float bounds[2] = { s_VulkanData.minResolutionScale, s_VulkanData.maxResolutionScale };
+        if (ImGui::SliderFloat2("Scale bounds", bounds, MIN_RESOLUTION_SCALE, 1.0f, "%.2f"))
+            VulkanRenderer::SetResolutionScaleBounds(bounds[0], bounds[1]);
+
+        const char* upscalerNames[] = { "Bilinear", "Edge adaptive" };
+        int upscaler = static_cast<int>(s_VulkanData.upscaler);
+        if (ImGui::Combo("Upscaler", &upscaler, upscalerNames, IM_ARRAYSIZE(upscalerNames)))
+            VulkanRenderer::SetUpscaler(static_cast<Upscaler>(upscaler));
+        if (s_VulkanData.upscaler == Upscaler::EdgeAdaptive)
+        {
+            if (ImGui::SliderFloat("Sharpness", &s_VulkanData.upscaleSharpness, 0.0f, 1.0f, "%.2f"))
+                GetWindow().Invalidate();
+        }
+
+        if (s_VulkanData.timestampPeriod == 0.0)
+            ImGui::Text("GPU timestamps unsupported, the scale stays at its upper bound");
+        else if (s_VulkanData.EnableDynamicResolution)
+        {
+            ImGui::Text("Scale %.2f, rendering %u x %u", s_VulkanData.resolutionScale, s_VulkanData.sceneRenderExtent.width, s_VulkanData.sceneRenderExtent.height);
+            ImGui::Text("GPU scene time: %.2f ms (target %.2f ms)", s_VulkanData.gpuSceneTime * 1000.0, GetFrameBudget() * DYNAMIC_RESOLUTION_HEADROOM * 1000.0);
+        }
+    }
+
+    FramePacingStats pacing = FrameTiming::GetStats();
+    float targetFrameRate = static_cast<float>(FrameTiming::GetTargetFrameRate());
+    if (ImGui::SliderFloat("Frame rate cap", &targetFrameRate, 0.0f, 360.0f, targetFrameRate > 0.0f ? "%.0f fps" : "Uncapped"))
+        FrameTiming::SetTargetFrameRate(targetFrameRate);
+    ImGui::Text("Frame time: %.2f ms avg, %.2f min, %.2f max, %.2f p99, %.2f jitter", pacing.averageMs, pacing.minMs, pacing.maxMs, pacing.percentile99Ms, pacing.jitterMs);
+
+    uint32_t historyOffset;
+    const float* history = FrameTiming::GetHistory(historyOffset);
+    ImGui::PlotLines("##FrameTimes", history, FRAME_HISTORY_SIZE, historyOffset, nullptr, 0.0f, pacing.maxMs * 1.2f, ImVec2(0.0f, 60.0f));
+
+    if (ImGui::CollapsingHeader("Frame stages"))
+    {
+        // Whichever wait dominates tells what the frame is bound by, without a big wait the CPU is the limit
+        float averages[FRAME_STAGE_COUNT] = {};
+        for (uint32_t stage = 0; stage < FRAME_STAGE_COUNT; stage++)
+        {
+            uint32_t stageOffset;
+            const float* stageHistory = FrameTiming::GetStageHistory(static_cast<FrameStage>(stage), stageOffset);
+
+            float maxMs = 0.0f;
+            for (uint32_t i = 0; i < pacing.frameCount; i++)
+            {
+                float ms = stageHistory[(stageOffset + i) % FRAME_HISTORY_SIZE];
+                averages[stage] += ms;
+                maxMs = std::max(maxMs, ms);
+            }
+            averages[stage] /= std::max(pacing.frameCount, 1u);
+
+            ImGui::Text("%s: %.2f ms avg, %.2f max", FrameTiming::GetStageName(static_cast<FrameStage>(stage)), averages[stage], maxMs);
+            ImGui::PushID(stage);
+            ImGui::PlotHistogram("##Stage", stageHistory, FRAME_HISTORY_SIZE, stageOffset, nullptr, 0.0f, maxMs * 1.2f, ImVec2(0.0f, 40.0f));
+            ImGui::PopID();
+        }
+
+        float fenceWait = averages[static_cast<uint32_t>(FrameStage::FenceWait)];
+        float acquireWait = averages[static_cast<uint32_t>(FrameStage::AcquireWait)];
+        const char* bound = "CPU";
+        if (fenceWait > 0.25f * pacing.averageMs && fenceWait >= acquireWait)
+            bound = "GPU";
+        else if (acquireWait > 0.25f * pacing.averageMs)
+            bound = "present";
+        ImGui::Text("Frames look %s-bound", bound);
+
+        if (ImGui::Button("Write frame timings CSV"))
+        {
+            if (FrameTiming::WriteHistoryCsv("frame_timings.csv"))
+                spdlog::info("Frame timings written to frame_timings.csv");
+            else
+                spdlog::error("Failed to write frame_timings.csv");
+        }
+    }
+    ImGui::Text("Entities: %u (%u drawn, extracted in %.2f ms)", static_cast<uint32_t>(s_VulkanData.candidateKeys.size()), s_VulkanData.renderQueue.GetCount(), s_VulkanData.extractionMilliseconds);
+    ImGui::Text("Draw calls: %u, pipeline binds: %u, mesh binds: %u", s_VulkanData.drawStats.drawCalls, s_VulkanData.drawStats.pipelineBinds, s_VulkanData.drawStats.meshBinds);
+    if (ImGui::Checkbox("Depth prepass", &s_VulkanData.EnableDepthPrepass))
+        GetWindow().Invalidate();
+    ImGui::SameLine();
+    ImGui::Text("(%u draws)", s_VulkanData.drawStats.prepassDrawCalls);
+    if (ImGui::Button("Spawn 100k entities"))
+        PostSimulationCommand([](EntityRegistry& entities) { SpawnEntityGrid(entities, 100000); });
+    ImGui::SameLine();
+    if (ImGui::Button("Clear entities"))
+        PostSimulationCommand([](EntityRegistry& entities) { entities.Clear(); });
+    ImGui::Text("Job threads: %u", JobSystem::GetThreadCount());
+    if (ImGui::Button("Run job system stress test"))
+        JobSystem::RunStressTest();
+    ImGui::SameLine();
+    if (ImGui::Button("Run job system benchmark"))
+        JobSystem::RunBenchmark();
+    ImGui::Text("Transform kernel: %s", TransformSystem::GetKernelName(s_VulkanData.entityTransforms.GetKernel()));
+    if (ImGui::Button("Run transform benchmark"))
+        TransformSystem::RunBenchmark(100000);
+    ImGui::Text("Descriptor pools: %u persistent, %u this frame", s_VulkanData.descriptorAllocator.GetPoolCount(),
+        s_VulkanData.frameDescriptorAllocators[currentFrame].GetPoolCount());
+
+
+    ImGui::End();
+
+    // A collapsed or hidden panel shows nothing, the scene is not drawn at all then
+    ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0.0f, 0.0f));
+    bool viewportOpen = ImGui::Begin("Viewport");
+    ImGui::PopStyleVar();
+
+    ImVec2 viewportPanelSize = ImGui::GetContentRegionAvail();
+    s_VulkanData.viewportVisible = SceneInViewport() && viewportOpen && viewportPanelSize.x >= 1.0f && viewportPanelSize.y >= 1.0f;
+    if (s_VulkanData.viewportVisible)
+    {
+        // The target matches the panel in framebuffer pixels, not the window's logical units
+        ImVec2 scale = ImGui::GetIO().DisplayFramebufferScale;
+        VkExtent2D panelExtent = { static_cast<uint32_t>(viewportPanelSize.x * scale.x), static_cast<uint32_t>(viewportPanelSize.y * scale.y) };
+        VkExtent2D& requestedExtent = s_VulkanData.viewportRequestedExtent;
+        if (panelExtent.width > 0 && panelExtent.height > 0 && (panelExtent.width != requestedExtent.width || panelExtent.height != requestedExtent.height))
+        {
+            requestedExtent = panelExtent;
+            s_VulkanData.viewportResizeTime = glfwGetTime();
+        }
+
+        // The target of this frame is drawn before the UI in the same command buffer
+        ImGui::Image((ImTextureID)s_VulkanData.viewportTextures[currentFrame], viewportPanelSize);
+    }
+    
+    ImGui::End(); 
+
+    ImGui::ShowDemoWindow(); 
+    ImGui::Render();  
+}
+
+void VulkanRenderer::ImGuiShutdown()
+{
+    // Resources to destroy when the program ends
+    ImGui_ImplVulkan_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+
+    vkDestroyDescriptorPool(s_VulkanData.device, s_VulkanData.imGuiDescriptorPool, nullptr);
+}
+     
+// Starts rendering into 'imageView' (a swapchain image or an offscreen target), which has to be in
+// COLOR_ATTACHMENT_OPTIMAL already, with 'depth' cleared to the far plane. Every pass has its depth attached, so the
+// scene, upscale and ImGui pipelines can share one. 'renderPass' and 'framebuffer' are only used by the imageless
+// framebuffer backend.
+static void BeginRendering(VkCommandBuffer commandBuffer, VkImageView imageView, const DepthBuffer& depth, VkExtent2D extent, VkRenderPass renderPass, VkFramebuffer framebuffer, VkAttachmentLoadOp loadOp)
+{
+    std::array<VkClearValue, 2> clearValues{};
+    clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+    clearValues[1].depthStencil = { 1.0f, 0 };
+    VkRect2D renderArea = { { 0, 0 }, extent };
 
-        CheckForError(vkCreateImage(s_VulkanData.device, &imageInfo, nullptr, &s_VulkanData.viewportImages[i]) != VK_SUCCESS, "Failed to create Image!");
+    if (s_VulkanData.renderingBackend == RenderingBackend::DynamicRendering)
+    {
+        VkRenderingAttachmentInfoKHR colorAttachment{};
+        colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        colorAttachment.imageView = imageView;
+        colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.loadOp = loadOp;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.clearValue = clearValues[0];
+
+        VkRenderingAttachmentInfoKHR depthAttachment{};
+        depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.clearValue = clearValues[1];
+
+        VkRenderingInfoKHR renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+        renderingInfo.renderArea = renderArea;
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachments = &colorAttachment;
+
+        // The previous frame may still be testing against the same image, its contents are not needed
+        VkImageMemoryBarrier depthBarrier{};
+        depthBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        depthBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        depthBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depthBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        depthBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        depthBarrier.image = depth.image;
+        depthBarrier.subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+
+        VkPipelineStageFlags depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        vkCmdPipelineBarrier(commandBuffer, depthStages, depthStages, 0, 0, nullptr, 0, nullptr, 1, &depthBarrier);
+
+        depthAttachment.imageView = depth.view;
+        renderingInfo.pDepthAttachment = &depthAttachment;
+
+        s_VulkanData.cmdBeginRendering(commandBuffer, &renderingInfo);
+        return;
+    }
 
-        VkMemoryRequirements memRequirements; 
-        vkGetImageMemoryRequirements(s_VulkanData.device, s_VulkanData.viewportImages[i], &memRequirements);
+    // The render pass orders the depth clear after the previous frame's tests itself
+    std::array<VkImageView, 2> attachments = { imageView, depth.view };
 
-        VkMemoryAllocateInfo allocInfo{} ;
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO; 
-        allocInfo.allocationSize = memRequirements.size; 
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT); 
-        CheckForError(vkAllocateMemory(s_VulkanData.device, &allocInfo, nullptr, &s_VulkanData.imageMemory[i]) != VK_SUCCESS, "Failed to allocate Image Memory!")
-        vkBindImageMemory(s_VulkanData.device, s_VulkanData.viewportImages[i], s_VulkanData.imageMemory[i], 0);
-    }
+    VkRenderPassAttachmentBeginInfo attachmentInfo{};
+    attachmentInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_ATTACHMENT_BEGIN_INFO;
+    attachmentInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    attachmentInfo.pAttachments = attachments.data();
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.pNext = &attachmentInfo;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = framebuffer;
+    renderPassInfo.renderArea = renderArea;
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 }
 
-void VulkanRenderer::CreateViewportImageViews() 
+// Leaves 'image' in 'finalLayout', PRESENT_SRC_KHR or SHADER_READ_ONLY_OPTIMAL. Done by the render pass's final layout,
+// which has to be the same, or by an explicit barrier. With dynamic rendering COLOR_ATTACHMENT_OPTIMAL is possible
+// too, for a following BeginRendering that loads what this one stored.
+static void EndRendering(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout finalLayout)
 {
-    s_VulkanData.swapChainImageViews.resize(s_VulkanData.swapChainImages.size()); 
-
-    for (size_t i = 0; i < s_VulkanData.swapChainImages.size(); i++)
+    if (s_VulkanData.renderingBackend == RenderingBackend::ImagelessFramebuffer)
     {
-        VkImageViewCreateInfo createInfo{}; 
-        createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO; 
-        createInfo.image = s_VulkanData.viewportImages[i];  
-        createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D; 
-        createInfo.format = s_VulkanData.swapChainImageFormat;    
-        createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT; 
-        createInfo.subresourceRange.baseMipLevel = 0;   
-        createInfo.subresourceRange.levelCount = 1;  
-        createInfo.subresourceRange.baseArrayLayer = 0;  
-        createInfo.subresourceRange.layerCount = 1; 
-
-        CheckForError(vkCreateImageView(s_VulkanData.device, &createInfo, nullptr, &s_VulkanData.viewportImageViews[i]) != VK_SUCCESS, "Failed to create Viewport Image Views!");
-        s_VulkanData.successQueue.push_back("Viewport Image Views successfully created!");
+        vkCmdEndRenderPass(commandBuffer);
+        return;
     }
+
+    s_VulkanData.cmdEndRendering(commandBuffer);
+
+    // Presenting needs no access of its own, a sampled target is read by the fragment shaders drawing the UI
+    bool sampled = finalLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    bool continued = finalLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkImageMemoryBarrier finalBarrier{};
+    finalBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    finalBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    finalBarrier.dstAccessMask = sampled ? VK_ACCESS_SHADER_READ_BIT : continued ? VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : 0;
+    finalBarrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    finalBarrier.newLayout = finalLayout;
+    finalBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    finalBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    finalBarrier.image = image;
+    finalBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    VkPipelineStageFlags dstStage = sampled ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : continued ? VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, dstStage, 0,
+        0, nullptr, 0, nullptr, 1, &finalBarrier);
 }
 
-void VulkanRenderer::CreateViewportRenderPass()
+// Normalized planes in the space 'matrix' transforms from, i.e. world space for view-projection
+static void ExtractFrustumPlanes(const glm::mat4& matrix, glm::vec4 planes[6])
 {
-
+    glm::vec4 row0(matrix[0][0], matrix[1][0], matrix[2][0], matrix[3][0]);
+    glm::vec4 row1(matrix[0][1], matrix[1][1], matrix[2][1], matrix[3][1]);
+    glm::vec4 row2(matrix[0][2], matrix[1][2], matrix[2][2], matrix[3][2]);
+    glm::vec4 row3(matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3]);
+
+    planes[0] = row3 + row0; // Left
+    planes[1] = row3 - row0; // Right
+    planes[2] = row3 + row1; // Bottom
+    planes[3] = row3 - row1; // Top
+    planes[4] = row3 + row2; // Near
+    planes[5] = row3 - row2; // Far
+
+    for (uint32_t i = 0; i < 6; i++)
+        planes[i] /= glm::length(glm::vec3(planes[i]));
 }
 
-void VulkanRenderer::CreateViewportPipeline()
+static MeshletCullConstants ComputeMeshletCullConstants()
 {
+    MeshletCullConstants constants{};
 
+    // Extracting the planes from the full model-view-projection matrix yields them in object space,
+    // which is where the meshlet bounds live
+    const glm::mat4& model = s_VulkanData.scene.GetWorldMatrix(s_VulkanData.quadNode);
+    ExtractFrustumPlanes(s_VulkanData.ubo.proj * s_VulkanData.ubo.view * model, constants.frustumPlanes);
+
+    // Camera position is the translation of the inverse model-view matrix
+    glm::mat4 inverseModelView = glm::inverse(s_VulkanData.ubo.view * model);
+    constants.cameraPosition = inverseModelView[3];
+    constants.meshletCount = s_VulkanData.meshletCount;
+
+    return constants;
 }
 
-void VulkanRenderer::CreateViewportCommandPool()
+// Walks the renderables of the latest simulation snapshot on the job system, interpolates them 'alpha' of the way
+// from the previous step, builds world matrices and bounds with the TransformSystem kernels, culls the bounds against
+// the camera and turns each survivor into a draw packet. The packets are sorted by state and the world matrices written
+// into this frame's instance buffer in that order, so neighbouring packets with the same state can be drawn as one
+// instanced draw. Each textured material requests the mip its largest visible draw needs on screen.
+static void ExtractRenderables(const FrameSnapshot& snapshot, float alpha)
 {
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    const glm::mat4& view = s_VulkanData.ubo.view;
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(s_VulkanData.ubo.proj * view, planes);
+
+    // View space z of a world position is a dot product with the third row of the view matrix
+    glm::vec4 viewDepthRow(view[0][2], view[1][2], view[2][2], view[3][2]);
+    float nearPlane = s_VulkanData.uboCamera.nearPlane;
+    float depthScale = 1.0f / (s_VulkanData.uboCamera.farPlane - nearPlane);
+
+    // Textures are sampled at the scene's render resolution, not the upscaled output
+    VkExtent2D renderExtent = SceneUpscaled() ? s_VulkanData.sceneRenderExtent : GetOutputExtent();
+    float pixelsPerUnit = s_VulkanData.ubo.proj[1][1] * 0.5f * renderExtent.height;
+
+    // Every renderable owns a candidate slot, so the jobs write without synchronization
+    uint32_t renderableCount = snapshot.GetRenderableCount();
+    std::vector<uint64_t>& keys = s_VulkanData.candidateKeys;
+    std::vector<DrawPacket>& packets = s_VulkanData.candidatePackets;
+    std::vector<float>& screenSizes = s_VulkanData.extractedScreenSizes;
+    TransformSystem& transforms = s_VulkanData.entityTransforms;
+    keys.resize(renderableCount);
+    packets.resize(renderableCount);
+    screenSizes.resize(renderableCount);
+    transforms.Resize(renderableCount);
+
+    const MaterialInfo* materialInfos = s_VulkanData.materialInfos.data();
+    const glm::vec4* worldBounds = transforms.GetWorldBounds();
+
+    // Jobs own whole kernel batches, each fills its slots of the transform arrays and runs the kernel over them
+    uint32_t batchCount = (renderableCount + TRANSFORM_BATCH_SIZE - 1) / TRANSFORM_BATCH_SIZE;
+    JobSystem::ParallelFor(batchCount, 0, [&](uint32_t firstBatch, uint32_t lastBatch)
+    {
+        uint32_t begin = firstBatch * TRANSFORM_BATCH_SIZE;
+        uint32_t end = glm::min(lastBatch * TRANSFORM_BATCH_SIZE, renderableCount);
+
+        for (uint32_t slot = begin; slot < end; slot++)
+        {
+            const Transform& previous = snapshot.previousTransforms[slot];
+            const Transform& current = snapshot.transforms[slot];
+
+            transforms.SetPosition(slot, glm::mix(previous.position, current.position, alpha));
+            transforms.SetRotation(slot, glm::slerp(previous.rotation, current.rotation, alpha));
+            transforms.SetScale(slot, glm::mix(previous.scale, current.scale, alpha));
+            transforms.SetLocalBounds(slot, snapshot.bounds[slot].sphere);
+        }
+
+        transforms.Update(begin, end);
+
+        for (uint32_t slot = begin; slot < end; slot++)
+        {
+            glm::vec3 center(worldBounds[slot]);
+            float radius = worldBounds[slot].w;
+
+            bool visible = true;
+            for (uint32_t plane = 0; plane < 6 && visible; plane++)
+                visible = glm::dot(glm::vec3(planes[plane]), center) + planes[plane].w >= -radius;
+
+            if (!visible)
+            {
+                keys[slot] = CULLED_SORT_KEY;
+                continue;
+            }
+
+            uint32_t material = snapshot.materials[slot].material;
+            uint32_t mesh = snapshot.meshes[slot].mesh;
+            const MaterialInfo& materialInfo = materialInfos[material];
+            float viewDepth = -(glm::dot(glm::vec3(viewDepthRow), center) + viewDepthRow.w);
+            float depth = (viewDepth - nearPlane) * depthScale;
+
+            // Projected diameter of the bounding sphere in pixels
+            screenSizes[slot] = 2.0f * radius * pixelsPerUnit / glm::max(viewDepth, nearPlane);
+
+            packets[slot] = { materialInfo.pipeline, material, mesh, slot };
+            keys[slot] = RenderQueue::MakeSortKey(materialInfo.pass, materialInfo.pipeline, material, mesh, depth);
+        }
+    });
+
+    RenderQueue& renderQueue = s_VulkanData.renderQueue;
+    renderQueue.Clear();
+    renderQueue.Reserve(renderableCount);
+
+    std::vector<float>& materialScreenSizes = s_VulkanData.materialScreenSizes;
+    materialScreenSizes.assign(s_VulkanData.materialInfos.size(), 0.0f);
+
+    for (uint32_t slot = 0; slot < renderableCount && renderQueue.GetCount() < MAX_ENTITY_INSTANCES; slot++)
+    {
+        if (keys[slot] == CULLED_SORT_KEY)
+            continue;
+
+        renderQueue.Push(keys[slot], packets[slot]);
+        float& materialScreenSize = materialScreenSizes[packets[slot].material];
+        materialScreenSize = glm::max(materialScreenSize, screenSizes[slot]);
+    }
+
+    // Materials without a visible draw make no request, their textures fall back to the mip tail
+    for (size_t material = 0; material < materialScreenSizes.size(); material++)
+    {
+        TextureHandle texture = materialInfos[material].albedoTexture;
+        if (texture != INVALID_TEXTURE && materialScreenSizes[material] > 0.0f)
+            TextureManager::RequestMip(texture, TextureManager::ComputeMipForScreenSize(texture, materialScreenSizes[material]));
+    }
 
+    renderQueue.Sort();
+
+    // Sorted order is instance order, a run of equal state covers a contiguous range of the instance buffer
+    glm::mat4* instances = static_cast<glm::mat4*>(s_VulkanData.instanceBuffersMapped[currentFrame]) + ENTITY_INSTANCE_OFFSET;
+    const glm::mat4* matrices = transforms.GetWorldMatrices();
+    JobSystem::ParallelFor(renderQueue.GetCount(), 0, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; i++)
+            instances[i] = matrices[renderQueue.GetSorted(i).object];
+    });
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    s_VulkanData.extractionMilliseconds = std::chrono::duration<float, std::milli>(endTime - startTime).count();
 }
 
-void VulkanRenderer::CreateViewportFramebuffers()
+static void recordMeshletCull(VkCommandBuffer commandBuffer)
 {
+    // Reset the indirect arguments, the cull pass appends to indexCount
+    VkDrawIndexedIndirectCommand resetCommand{};
+    resetCommand.instanceCount = 1;
+    vkCmdUpdateBuffer(commandBuffer, s_VulkanData.drawCommandBuffers[currentFrame], 0, sizeof(resetCommand), &resetCommand);
+
+    VkBufferMemoryBarrier resetBarrier{};
+    resetBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    resetBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    resetBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    resetBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    resetBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    resetBarrier.buffer = s_VulkanData.drawCommandBuffers[currentFrame];
+    resetBarrier.offset = 0;
+    resetBarrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &resetBarrier, 0, nullptr);
+
+    MeshletCullConstants constants = ComputeMeshletCullConstants();
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s_VulkanData.meshletCullPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s_VulkanData.meshletCullPipelineLayout, 0, 1, &s_VulkanData.meshletCullDescriptorSets[currentFrame], 0, nullptr);
+    vkCmdPushConstants(commandBuffer, s_VulkanData.meshletCullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(commandBuffer, (s_VulkanData.meshletCount + 63) / 64, 1, 1);
+
+    // Make the compacted indices and the draw arguments visible to the input assembler and indirect fetch
+    std::array<VkBufferMemoryBarrier, 2> cullBarriers{};
+    for (VkBufferMemoryBarrier& barrier : cullBarriers)
+    {
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+    }
+    cullBarriers[0].dstAccessMask = VK_ACCESS_INDEX_READ_BIT;
+    cullBarriers[0].buffer = s_VulkanData.compactedIndexBuffers[currentFrame];
+    cullBarriers[1].dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    cullBarriers[1].buffer = s_VulkanData.drawCommandBuffers[currentFrame];
 
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+        0, 0, nullptr, static_cast<uint32_t>(cullBarriers.size()), cullBarriers.data(), 0, nullptr);
 }
 
-void VulkanRenderer::CreateViewportCommandBuffers()
+// Draws the quad's indices, with whichever vertex stream and push constants are bound
+static void recordQuadDraw(VkCommandBuffer commandBuffer)
 {
-
+    if (s_VulkanData.EnableMeshletCulling)
+    {
+        // Only the surviving clusters are in the compacted index buffer, the count comes from the cull pass
+        vkCmdBindIndexBuffer(commandBuffer, s_VulkanData.compactedIndexBuffers[currentFrame], 0, VK_INDEX_TYPE_UINT32);
+        vkCmdDrawIndexedIndirect(commandBuffer, s_VulkanData.drawCommandBuffers[currentFrame], 0, 1, sizeof(VkDrawIndexedIndirectCommand));
+    }
+    else
+    {
+        vkCmdBindIndexBuffer(commandBuffer, s_VulkanData.indexBuffer, 0, VK_INDEX_TYPE_UINT16); 
+        vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);      
+    }
 }
 
-void VulkanRenderer::CreateViewportTextureSampler() 
+// Writes the depth of the quad and of every opaque entity without shading anything, 'drawConstants' holding the
+// quad's. The prepass reads no material, so a run of packets sharing a mesh is one instanced draw whatever their
+// materials. Returns the number of draws.
+static uint32_t recordDepthPrepass(VkCommandBuffer commandBuffer, DrawConstants drawConstants)
 {
-    VkSamplerCreateInfo samplerInfo{};
-    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    samplerInfo.magFilter = VK_FILTER_LINEAR;
-    samplerInfo.minFilter = VK_FILTER_LINEAR;
-    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.anisotropyEnable = VK_FALSE;
-    samplerInfo.maxAnisotropy = 1.0f;
-    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-    samplerInfo.unnormalizedCoordinates = VK_FALSE;
-    samplerInfo.compareEnable = VK_FALSE;
-    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-    samplerInfo.mipLodBias = 0.0f;
-    samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 0.0f;
-
-    CheckForError(vkCreateSampler(s_VulkanData.device, &samplerInfo, nullptr, &s_VulkanData.textureSampler) != VK_SUCCESS, "Failed to create texture sampler!")
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s_VulkanData.depthPrepassPipeline);
+
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &s_VulkanData.positionBuffer, &offset);
+    vkCmdPushConstants(commandBuffer, s_VulkanData.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(DrawConstants), &drawConstants);
+    recordQuadDraw(commandBuffer);
+    uint32_t drawCalls = 1;
+
+    const RenderQueue& renderQueue = s_VulkanData.renderQueue;
+    const std::vector<MaterialInfo>& materialInfos = s_VulkanData.materialInfos;
+    uint32_t boundMesh = UINT32_MAX;
+
+    for (uint32_t first = 0; first < renderQueue.GetCount();)
+    {
+        // Opaque packets sort first. Blended ones are tested against the finished depth and never lay it down here.
+        const DrawPacket& packet = renderQueue.GetSorted(first);
+        if (materialInfos[packet.material].pass != DrawPassOpaque)
+            break;
+
+        uint32_t last = first + 1;
+        while (last < renderQueue.GetCount())
+        {
+            const DrawPacket& next = renderQueue.GetSorted(last);
+            if (next.mesh != packet.mesh || materialInfos[next.material].pass != DrawPassOpaque)
+                break;
+            last++;
+        }
+
+        const Mesh& mesh = s_VulkanData.meshes[packet.mesh];
+        if (packet.mesh != boundMesh)
+        {
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mesh.positionBuffer, &offset);
+            vkCmdBindIndexBuffer(commandBuffer, mesh.indexBuffer, 0, mesh.indexType);
+            boundMesh = packet.mesh;
+        }
+
+        drawConstants.materialIndex = packet.material;
+        drawConstants.objectId = ENTITY_INSTANCE_OFFSET + first;
+        vkCmdPushConstants(commandBuffer, s_VulkanData.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(DrawConstants), &drawConstants);
+        vkCmdDrawIndexed(commandBuffer, mesh.indexCount, last - first, 0, 0, 0);
+        drawCalls++;
+
+        first = last;
+    }
+
+    return drawCalls;
 }
 
-void VulkanRenderer::ImGuiOnUpdate(uint32_t imageIndex)   
+// Draws the quad and the extracted entities into the target rendering has begun on, 'extent' being its size
+static void recordSceneDraws(VkCommandBuffer commandBuffer, VkExtent2D extent)
 {
-    ImGui_ImplVulkan_NewFrame(); 
-    ImGui_ImplGlfw_NewFrame(); 
-    ImGui::NewFrame(); 
-    //ImGui::DockSpaceOverViewport(ImGui::GetMainViewport());
-    
-    static auto startTime = std::chrono::high_resolution_clock::now();
+    // Set the viewport for the rendering
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    // Set the scissor region for the rendering
+    VkRect2D scissor{};
+    scissor.offset = { 0, 0 };
+    scissor.extent = extent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-    auto currentTime = std::chrono::high_resolution_clock::now();
-    float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+    // Both sets are bound once for the whole frame, draws only push their constants
+    std::array<VkDescriptorSet, 2> descriptorSets = { s_VulkanData.descriptorSets[currentFrame], BindlessDescriptors::GetDescriptorSet(currentFrame) };
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s_VulkanData.pipelineLayout, 0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr);
 
+    DrawConstants drawConstants{};
+    drawConstants.model = glm::mat4(1.0f);
+    drawConstants.materialIndex = s_VulkanData.defaultMaterial;
+    drawConstants.objectId = s_VulkanData.scene.GetInstanceIndex(s_VulkanData.quadNode);
 
-    s_VulkanData.ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-    s_VulkanData.ubo.view  = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-    s_VulkanData.ubo.proj  = glm::perspective(glm::radians(45.0f), (float)s_VulkanData.swapChainExtent.width / (float)s_VulkanData.swapChainExtent.height, 0.1f, 10.0f);
+    // The depth test of the shading pass then only passes the nearest fragment of each pixel, hidden surfaces
+    // cost vertex work and a depth test but no shading
+    uint32_t prepassDrawCalls = s_VulkanData.EnableDepthPrepass ? recordDepthPrepass(commandBuffer, drawConstants) : 0;
 
-    s_VulkanData.ubo.proj[1][1] *= -1;
+    // Opaque draws the prepass covered shade with the depth equal variants, everything else with the regular ones
+    bool prepassed = prepassDrawCalls > 0;
+    const std::vector<MaterialInfo>& materialInfos = s_VulkanData.materialInfos;
+    auto shadingPipeline = [&](uint32_t pipeline, uint32_t material)
+    {
+        bool covered = prepassed && materialInfos[material].pass == DrawPassOpaque;
+        return covered ? s_VulkanData.depthEqualPipelines[pipeline] : s_VulkanData.pipelines[pipeline];
+    };
 
-    memcpy(s_VulkanData.uniformBuffersMapped[imageIndex], &s_VulkanData.ubo, sizeof(s_VulkanData.ubo));
+    // Bind a graphics pipeline to the command buffer
+    VkPipeline boundPipeline = shadingPipeline(DEFAULT_PIPELINE, s_VulkanData.defaultMaterial);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, boundPipeline);
 
+    VkBuffer vertexBuffers[] = { s_VulkanData.vertexBuffer }; 
+    VkDeviceSize offsets[] = { 0 };
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);    
 
-    ImGui::Begin("Vulkan Renderer"); 
+    vkCmdPushConstants(commandBuffer, s_VulkanData.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(DrawConstants), &drawConstants);
+    recordQuadDraw(commandBuffer);
 
+    // Extracted entities in sort order. Every run of packets sharing pipeline, material and mesh becomes one
+    // instanced draw, and pipelines and buffers are only bound when the run's state differs from the last one.
+    // Both descriptor sets stay bound across pipeline changes since all pipelines share one layout.
+    const RenderQueue& renderQueue = s_VulkanData.renderQueue;
+    DrawStats stats{};
+    stats.drawCalls = 1;
+    stats.pipelineBinds = prepassDrawCalls > 0 ? 2 : 1;
+    stats.prepassDrawCalls = prepassDrawCalls;
 
+    uint32_t boundMesh = UINT32_MAX;
 
-    ImGui::End();
+    for (uint32_t first = 0; first < renderQueue.GetCount();)
+    {
+        const DrawPacket& packet = renderQueue.GetSorted(first);
 
-    //VkDescriptorSet descriptorSet;   
-    //descriptorSet = ImGui_ImplVulkan_AddTexture(s_VulkanData.textureSampler, s_VulkanData.viewportImageViews[imageIndex], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    
-    ImGui::Begin("Viewport");
-    //
-    //ImVec2 viewportPanelSize = ImGui::GetContentRegionAvail();
-    //ImGui::Image(descriptorSet, ImVec2{ viewportPanelSize.x, viewportPanelSize.y });
-    
-    ImGui::End(); 
+        uint32_t last = first + 1;
+        while (last < renderQueue.GetCount())
+        {
+            const DrawPacket& next = renderQueue.GetSorted(last);
+            if (next.pipeline != packet.pipeline || next.material != packet.material || next.mesh != packet.mesh)
+                break;
+            last++;
+        }
 
-    ImGui::ShowDemoWindow(); 
-    ImGui::Render();  
+        VkPipeline pipeline = shadingPipeline(packet.pipeline, packet.material);
+        if (pipeline != boundPipeline)
+        {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            boundPipeline = pipeline;
+            stats.pipelineBinds++;
+        }
+
+        const Mesh& mesh = s_VulkanData.meshes[packet.mesh];
+        if (packet.mesh != boundMesh)
+        {
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mesh.vertexBuffer, offsets);
+            vkCmdBindIndexBuffer(commandBuffer, mesh.indexBuffer, 0, mesh.indexType);
+            boundMesh = packet.mesh;
+            stats.meshBinds++;
+        }
+
+        // shader.vert adds gl_InstanceIndex to objectId
+        drawConstants.materialIndex = packet.material;
+        drawConstants.objectId = ENTITY_INSTANCE_OFFSET + first;
+        vkCmdPushConstants(commandBuffer, s_VulkanData.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(DrawConstants), &drawConstants);
+        vkCmdDrawIndexed(commandBuffer, mesh.indexCount, last - first, 0, 0, 0);
+        stats.drawCalls++;
+
+        first = last;
+    }
+
+    s_VulkanData.drawStats = stats;
+
+    // Closes the measurement opened in recordSceneCommandBuffer, the upscale and the UI are not part of it
+    if (s_VulkanData.timestampsWritten[currentFrame])
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, s_VulkanData.timestampQueryPool, currentFrame * 2 + 1);
 }
 
-void VulkanRenderer::ImGuiShutdown()
+// Starts rendering into the top left 'renderExtent' of this frame's image of 'targets'. Its old contents are dropped.
+static void BeginOffscreenRendering(VkCommandBuffer commandBuffer, const OffscreenTargets& targets, VkExtent2D renderExtent)
 {
-    // Resources to destroy on swapchain recreation
-    for (auto framebuffer : s_VulkanData.imGuiFramebuffers)
-        vkDestroyFramebuffer(s_VulkanData.device, framebuffer, nullptr);
+    VkImageMemoryBarrier targetBarrier{};
+    targetBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    targetBarrier.srcAccessMask = 0;
+    targetBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    targetBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED; // Last frame's contents are not needed
+    targetBarrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    targetBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    targetBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    targetBarrier.image = targets.images[currentFrame];
+    targetBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    // The frame that used this target last sampled it in its fragment shaders
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+        0, nullptr, 0, nullptr, 1, &targetBarrier);
+
+    BeginRendering(commandBuffer, targets.views[currentFrame], targets.depth, renderExtent, s_VulkanData.offscreenRenderPass, targets.framebuffer, VK_ATTACHMENT_LOAD_OP_CLEAR);
+}
 
-    vkDestroyRenderPass(s_VulkanData.device, s_VulkanData.imGuiRenderPass, nullptr);
-    vkDestroyCommandPool(s_VulkanData.device, s_VulkanData.imGuiCommandPool, nullptr);
+// Stretches the part of this frame's scene color target the scene was rendered into over the whole output
+static void recordUpscale(VkCommandBuffer commandBuffer, VkExtent2D outputExtent)
+{
+    const OffscreenTargets& source = s_VulkanData.sceneColorTargets;
 
-    // Resources to destroy when the program ends
-    ImGui_ImplVulkan_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
+    // The source changes with every frame in flight and every resize, a set from this frame's allocator is simplest
+    VkDescriptorSet descriptorSet = s_VulkanData.frameDescriptorAllocators[currentFrame].Allocate(s_VulkanData.upscaleSetLayout);
 
-    vkDestroyDescriptorPool(s_VulkanData.device, s_VulkanData.imGuiDescriptorPool, nullptr);
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.sampler = s_VulkanData.upscaleSampler;
+    imageInfo.imageView = source.views[currentFrame];
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = descriptorSet;
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(s_VulkanData.device, 1, &descriptorWrite, 0, nullptr);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s_VulkanData.upscalePipeline);
+
+    VkViewport viewport{ 0.0f, 0.0f, static_cast<float>(outputExtent.width), static_cast<float>(outputExtent.height), 0.0f, 1.0f };
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    VkRect2D scissor{ { 0, 0 }, outputExtent };
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s_VulkanData.upscalePipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+    glm::vec2 sourceSize(source.extent.width, source.extent.height);
+    glm::vec2 renderSize(s_VulkanData.sceneRenderExtent.width, s_VulkanData.sceneRenderExtent.height);
+
+    UpscaleConstants constants{};
+    constants.uvScale = renderSize / sourceSize;
+    constants.uvMax = (renderSize - 0.5f) / sourceSize; // Bilinear taps past the last rendered texel would blend in stale pixels
+    constants.texelSize = 1.0f / sourceSize;
+    constants.upscaler = static_cast<uint32_t>(s_VulkanData.upscaler);
+    constants.sharpness = s_VulkanData.upscaleSharpness;
+    vkCmdPushConstants(commandBuffer, s_VulkanData.upscalePipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(constants), &constants);
+
+    // One triangle covering the output, the vertex shader makes it from the vertex index
+    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
 }
-     
-void recordImGuiCommandBuffer(uint32_t imageIndex)
-{
-    VkCommandBufferBeginInfo info = {};
-    info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    info.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-    vkBeginCommandBuffer(s_VulkanData.imGuiCommandBuffer, &info);
-
-    VkImageMemoryBarrier imageBarrierImGui = {};
-    imageBarrierImGui.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    imageBarrierImGui.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-    imageBarrierImGui.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    imageBarrierImGui.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;  
-    imageBarrierImGui.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;  
-    imageBarrierImGui.image = s_VulkanData.swapChainImages[imageIndex]; // Replace with the correct swapchain image 
-    imageBarrierImGui.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    imageBarrierImGui.subresourceRange.baseMipLevel = 0;
-    imageBarrierImGui.subresourceRange.levelCount = 1;
-    imageBarrierImGui.subresourceRange.baseArrayLayer = 0;
-    imageBarrierImGui.subresourceRange.layerCount = 1;
 
-    vkCmdPipelineBarrier(
-        s_VulkanData.imGuiCommandBuffer,
-        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        0,
-        0, nullptr,
-        0, nullptr,
-        1, &imageBarrierImGui
-    );
+// Records the scene's offscreen passes. They run without waiting for the swapchain image, so the GPU time measured
+// here, which drives dynamic resolution, never includes the wait for vsync.
+static void recordSceneCommandBuffer(VkCommandBuffer commandBuffer)
+{
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    CheckForError(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS, "Failed to begin recording Command Buffer!");
 
-    VkClearValue clearColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+    bool timed = s_VulkanData.timestampQueryPool != VK_NULL_HANDLE;
+    s_VulkanData.timestampsWritten[currentFrame] = timed;
+    if (timed)
+    {
+        vkCmdResetQueryPool(commandBuffer, s_VulkanData.timestampQueryPool, currentFrame * 2, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, s_VulkanData.timestampQueryPool, currentFrame * 2);
+    }
 
-    VkRenderPassBeginInfo renderInfo = {};
-    renderInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderInfo.renderPass = s_VulkanData.imGuiRenderPass;
-    renderInfo.framebuffer = s_VulkanData.swapChainFramebuffers[imageIndex];
-    renderInfo.renderArea.extent.width = s_VulkanData.swapChainExtent.width;
-    renderInfo.renderArea.extent.height = s_VulkanData.swapChainExtent.height;
-    renderInfo.clearValueCount = 1;
-    renderInfo.pClearValues = &clearColor;
+    // Cluster culling has to run outside the render pass
+    if (s_VulkanData.EnableMeshletCulling)
+        recordMeshletCull(commandBuffer);
 
-    vkCmdBeginRenderPass(s_VulkanData.imGuiCommandBuffer, &renderInfo, VK_SUBPASS_CONTENTS_INLINE);
+    bool upscale = SceneUpscaled();
+    if (upscale)
+    {
+        BeginOffscreenRendering(commandBuffer, s_VulkanData.sceneColorTargets, s_VulkanData.sceneRenderExtent);
+        recordSceneDraws(commandBuffer, s_VulkanData.sceneRenderExtent);
+        EndRendering(commandBuffer, s_VulkanData.sceneColorTargets.images[currentFrame], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
 
-    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), s_VulkanData.imGuiCommandBuffer);
+    // The scene goes into this frame's viewport target, the swapchain pass only draws the UI sampling it
+    if (SceneInViewport())
+    {
+        const OffscreenTargets& viewport = s_VulkanData.viewportTargets;
+        BeginOffscreenRendering(commandBuffer, viewport, viewport.extent);
+        if (upscale)
+            recordUpscale(commandBuffer, viewport.extent);
+        else
+            recordSceneDraws(commandBuffer, viewport.extent);
+        EndRendering(commandBuffer, viewport.images[currentFrame], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
 
-    vkCmdEndRenderPass(s_VulkanData.imGuiCommandBuffer);
-    vkEndCommandBuffer(s_VulkanData.imGuiCommandBuffer);
+    CheckForError(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS, "Failed to record Command Buffer!");
 }
 
 void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) 
@@ -1305,50 +3323,30 @@ void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
         1, &imageBarrier
     );
 
-    // Initialize a VkRenderPassBeginInfo structure
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = s_VulkanData.renderPass;
-    renderPassInfo.framebuffer = s_VulkanData.swapChainFramebuffers[imageIndex];
-    renderPassInfo.renderArea.offset = { 0, 0 };
-    renderPassInfo.renderArea.extent = s_VulkanData.swapChainExtent;
-
-    // Configure the clear color for the render pass
-    VkClearValue clearColor = { { { 0.0f, 0.0f, 0.0f, 1.0f } } };
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &clearColor;
-
-    // Begin a render pass
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-    // Bind a graphics pipeline to the command buffer
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s_VulkanData.graphicsPipeline);
-
-    // Set the viewport for the rendering
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(s_VulkanData.swapChainExtent.width);
-    viewport.height = static_cast<float>(s_VulkanData.swapChainExtent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    // Drawn straight into the swapchain image, the scene is not timed, its pass can only start once the image is
+    // acquired. Dynamic resolution, the only user of the measurement, always renders it offscreen.
+    bool drawScene = SceneVisible() && !SceneOffscreen();
 
-    // Set the scissor region for the rendering
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = s_VulkanData.swapChainExtent;
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    // Cluster culling has to run outside the render pass
+    if (s_VulkanData.EnableMeshletCulling && drawScene)
+        recordMeshletCull(commandBuffer);
 
-    VkBuffer vertexBuffers[] = { s_VulkanData.vertexBuffer }; 
-    VkDeviceSize offsets[] = { 0 };
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);    
-    vkCmdBindIndexBuffer(commandBuffer, s_VulkanData.indexBuffer, 0, VK_INDEX_TYPE_UINT16); 
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s_VulkanData.pipelineLayout, 0, 1, &s_VulkanData.descriptorSets[currentFrame], 0, nullptr);
-    vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);      
+    VkImageView swapChainImageView = s_VulkanData.swapChainImageViews[imageIndex];
+    BeginRendering(commandBuffer, swapChainImageView, s_VulkanData.swapChainDepth, s_VulkanData.swapChainExtent, s_VulkanData.renderPass, s_VulkanData.swapChainFramebuffer, VK_ATTACHMENT_LOAD_OP_CLEAR);
+    if (drawScene)
+        recordSceneDraws(commandBuffer, s_VulkanData.swapChainExtent);
+    else if (SceneUpscaled() && !SceneInViewport())
+        recordUpscale(commandBuffer, s_VulkanData.swapChainExtent);
+    else if (!SceneVisible())
+        s_VulkanData.drawStats = DrawStats{};
 
     // End the render pass
-    vkCmdEndRenderPass(commandBuffer);
+    // The UI blends straight over the scene in the same pass, the color attachment never leaves tile
+    // memory in between. It only draws over what the scene wrote, so it needs no subpass or barrier of its own.
+    if (s_VulkanData.EnableImGui)
+        ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+
+    EndRendering(commandBuffer, s_VulkanData.swapChainImages[imageIndex], VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 
     // End recording the command buffer
     CheckForError(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS, "Failed to record Command Buffer!");
@@ -1357,33 +3355,99 @@ void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
 void drawFrame()                                                                                                                                                           
 {                                                                                                                                                                          
     // Wait for the in-flight fence to signal, indicating the completion of previous frame's rendering
+    double stageStart = FrameTiming::Now();
     vkWaitForFences(s_VulkanData.device, 1, &s_VulkanData.inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    FrameTiming::AddStageTime(FrameStage::FenceWait, FrameTiming::Now() - stageStart);
+
+    // Sets handed out for this frame slot last time are no longer in use
+    s_VulkanData.frameDescriptorAllocators[currentFrame].Reset();
+    VulkanRenderer::DestroyRetiredObjects(false);
+    bool measured = ReadGpuSceneTime();
+
+    // A drag produces a stream of resize events, the swapchain is only rebuilt once they have settled.
+    // Until then the old one keeps presenting, stretched by the presentation engine.
+    Window::WindowData* windowData = GetWindow().GetData();
+    bool resizeSettled = windowData->framebufferResized && glfwGetTime() - windowData->lastResizeTime >= RESIZE_SETTLE_SECONDS;
+    if (resizeSettled || s_VulkanData.swapChainSettingsChanged)
+    {
+        windowData->framebufferResized = false;
+        s_VulkanData.swapChainSettingsChanged = false;
+        VulkanRenderer::RecreateSwapChain();
+    }
+
+    // The viewport panel is debounced the same way, ImGui stretches the old target over it meanwhile
+    VkExtent2D requestedExtent = s_VulkanData.viewportRequestedExtent;
+    VkExtent2D viewportExtent = s_VulkanData.viewportTargets.extent;
+    bool viewportResized = requestedExtent.width != viewportExtent.width || requestedExtent.height != viewportExtent.height;
+    if (SceneInViewport() && viewportResized && glfwGetTime() - s_VulkanData.viewportResizeTime >= RESIZE_SETTLE_SECONDS)
+        VulkanRenderer::ResizeViewport(requestedExtent.width, requestedExtent.height);
+
+    // After both resizes, the scene targets follow whichever output the scene ends up in
+    UpdateDynamicResolution(measured);
 
     // Acquire the next available image from the swap chain for rendering
     uint32_t imageIndex;
+    stageStart = FrameTiming::Now();
     VkResult result = vkAcquireNextImageKHR(s_VulkanData.device, s_VulkanData.swapChain, UINT64_MAX, s_VulkanData.imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    FrameTiming::AddStageTime(FrameStage::AcquireWait, FrameTiming::Now() - stageStart);
+    stageStart = FrameTiming::Now();
 
+    // The old swapchain can no longer be presented to, waiting for the resize to settle is not an option
     if (result == VK_ERROR_OUT_OF_DATE_KHR)
     {      
+        windowData->framebufferResized = false;
         VulkanRenderer::RecreateSwapChain();
+        GetWindow().Invalidate();
         return;
     }
     else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
         CheckForError(true, "Failed to acquire Swap Chain Image!");
     
+    // Streamed textures swap their views here, before anything of this frame is recorded
+    TextureManager::Update();
+
+    // This frame's copy of the bindless set is idle now, bring it up to date
+    BindlessDescriptors::BeginFrame(currentFrame);
+    VulkanRenderer::UpdateUniformBuffer(currentFrame);
 
-    // Reset the command buffer for recording new commands
-    vkResetCommandBuffer(s_VulkanData.commandBuffers[currentFrame], 0);
-    recordCommandBuffer(s_VulkanData.commandBuffers[currentFrame], imageIndex); // Record rendering commands
 
-    // ImGui
+    // Newest complete simulation step, never waits for the simulation thread
+    const FrameSnapshot& snapshot = s_VulkanData.snapshots.AcquireLatest();
+    s_VulkanData.renderedSimulationFrame = snapshot.simulationFrame;
+    s_VulkanData.renderedSnapshotChanged = snapshot.changed;
+
+    // Rendering runs one fixed step behind the simulation and blends between the last two steps,
+    // so motion stays smooth whatever the ratio of frame rate to simulation rate is
+    double step = FrameTiming::GetFixedTimestep();
+    float alpha = static_cast<float>(glm::clamp((FrameTiming::Now() - snapshot.simulationTime) / step, 0.0, 1.0));
+    s_VulkanData.interpolationAlpha = alpha;
+
+    // Only the quad's node animates, driven by simulation time so it matches the rest of the snapshot
+    float time = static_cast<float>(snapshot.simulationTime - step + alpha * step);
+    if (s_VulkanData.animateQuad)
+        s_VulkanData.scene.SetLocalRotation(s_VulkanData.quadNode, glm::angleAxis(time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
+
+    // ImGui also updates the matrices, so it runs before recording for the cull pass to see this frame's camera
     if (s_VulkanData.EnableImGui) 
-    {
         VulkanRenderer::ImGuiOnUpdate(imageIndex);
-        vkResetCommandBuffer(s_VulkanData.imGuiCommandBuffer, 0);
-        vkResetCommandPool(s_VulkanData.device, s_VulkanData.imGuiCommandPool, 0); 
-        recordImGuiCommandBuffer(imageIndex); 
+
+    // Input polled before this point is visible to this frame
+    double inputTime = GetWindow().ConsumeInputTime();
+
+    // Only subtrees that moved are recomputed, and only matrices this frame's buffer has not seen are copied
+    s_VulkanData.scene.Update();
+    s_VulkanData.scene.WriteInstances(s_VulkanData.instanceBuffersMapped[currentFrame], currentFrame);
+    ExtractRenderables(snapshot, alpha);
+
+    // Reset the command buffers for recording new commands
+    bool sceneOffscreen = SceneOffscreen();
+    if (sceneOffscreen)
+    {
+        vkResetCommandBuffer(s_VulkanData.sceneCommandBuffers[currentFrame], 0);
+        recordSceneCommandBuffer(s_VulkanData.sceneCommandBuffers[currentFrame]);
     }
+    vkResetCommandBuffer(s_VulkanData.commandBuffers[currentFrame], 0);
+    recordCommandBuffer(s_VulkanData.commandBuffers[currentFrame], imageIndex); // Record rendering commands
 
     // Reset the in-flight fence for the next frame
     vkResetFences(s_VulkanData.device, 1, &s_VulkanData.inFlightFences[currentFrame]);
@@ -1398,26 +3462,31 @@ void drawFrame()
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
 
-    // ImGui Code
-    if (s_VulkanData.EnableImGui)
-    {
-        std::array<VkCommandBuffer, 2> submitCommandBuffers =
-        { s_VulkanData.commandBuffers[currentFrame], s_VulkanData.imGuiCommandBuffer };
-        submitInfo.commandBufferCount = static_cast<uint32_t>(submitCommandBuffers.size());
-        submitInfo.pCommandBuffers = submitCommandBuffers.data();
-    }
-    else
-    {
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &s_VulkanData.commandBuffers[currentFrame];
-    }
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &s_VulkanData.commandBuffers[currentFrame];
      
     VkSemaphore signalSemaphores[] = { s_VulkanData.renderFinishedSemaphores[currentFrame] };
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
+    // The offscreen scene goes in its own batch ahead of it, with nothing to wait for. The barriers ending its
+    // passes still order it before the UI that samples the result, batches execute in submission order.
+    VkSubmitInfo sceneSubmitInfo{};
+    sceneSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    sceneSubmitInfo.commandBufferCount = 1;
+    sceneSubmitInfo.pCommandBuffers = &s_VulkanData.sceneCommandBuffers[currentFrame];
+
+    VkSubmitInfo submitInfos[] = { sceneSubmitInfo, submitInfo };
+    uint32_t submitCount = sceneOffscreen ? 2 : 1;
+    const VkSubmitInfo* submits = sceneOffscreen ? submitInfos : &submitInfo;
+
+    FrameTiming::AddStageTime(FrameStage::Record, FrameTiming::Now() - stageStart);
+
     // Submit rendering commands to the graphics queue
-    CheckForError(vkQueueSubmit(s_VulkanData.graphicsQueue, 1, &submitInfo, s_VulkanData.inFlightFences[currentFrame]) != VK_SUCCESS, "Failed to submit draw Command Buffer!");
+    stageStart = FrameTiming::Now();
+    CheckForError(vkQueueSubmit(s_VulkanData.graphicsQueue, submitCount, submits, s_VulkanData.inFlightFences[currentFrame]) != VK_SUCCESS, "Failed to submit draw Command Buffer!");
+
+    FrameTiming::AddStageTime(FrameStage::Submit, FrameTiming::Now() - stageStart);
 
     // Configure the presentation of the rendered image to the screen
     VkPresentInfoKHR presentInfo{};
@@ -1432,24 +3501,61 @@ void drawFrame()
     presentInfo.pResults = nullptr; // Optional
 
     // Present the rendered image to the screen
+    stageStart = FrameTiming::Now();
     result = vkQueuePresentKHR(s_VulkanData.presentQueue, &presentInfo);
+    FrameTiming::AddStageTime(FrameStage::Present, FrameTiming::Now() - stageStart);
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+    if (result == VK_ERROR_OUT_OF_DATE_KHR)
     {
-        auto windowData = GetWindow().GetData();
         windowData->framebufferResized = false;
         VulkanRenderer::RecreateSwapChain(); 
     }    
+    else if (result == VK_SUBOPTIMAL_KHR)
+        windowData->framebufferResized = true; // Still presentable, rebuilt through the debounce above
     else if (result != VK_SUCCESS) 
         CheckForError(true, "Failed to present Swap Chain Image!");
+
+    if (inputTime > 0.0)
+    {
+        double latency = FrameTiming::Now() - inputTime + EstimateScanoutDelay();
+        double& smoothed = s_VulkanData.inputToPresentLatency;
+        smoothed = smoothed == 0.0 ? latency : smoothed + LATENCY_SMOOTHING * (latency - smoothed);
+    }
          
+    s_VulkanData.frameNumber++;
     currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;   
 }    
     
+// Whether the frame just drawn is not the final picture yet, even if nothing else changes
+static bool NeedsAnotherFrame()
+{
+    TextureStats textureStats = TextureManager::GetStats();
+
+    VkExtent2D viewportRequest = s_VulkanData.viewportRequestedExtent;
+    bool viewportResizePending = SceneInViewport() &&
+        (viewportRequest.width != s_VulkanData.viewportTargets.extent.width || viewportRequest.height != s_VulkanData.viewportTargets.extent.height);
+
+    return s_VulkanData.animateQuad || GetWindow().GetData()->framebufferResized || viewportResizePending ||
+        textureStats.pendingReads > 0 || textureStats.pendingUploads > 0 ||
+        (s_VulkanData.renderedSnapshotChanged && s_VulkanData.interpolationAlpha < 1.0f);
+}
+
 void VulkanRenderer::OnUpdate()
 {
+    Window& window = GetWindow();
+
+    // In on-demand mode a frame is only drawn when something invalidated the window. A focused text field
+    // also draws on the idle timeout, which is what keeps its cursor blinking.
+    if (window.IsOnDemandRendering() && !window.ConsumeRedraw() && !s_VulkanData.uiTextInputActive)
+        return;
+
+    // No wait for the GPU here, the next frame's fence wait keeps at most MAX_FRAMES_IN_FLIGHT frames queued
     drawFrame();
-    vkDeviceWaitIdle(s_VulkanData.device); 
+
+    if (window.IsOnDemandRendering() && NeedsAnotherFrame())
+        window.Invalidate();
+
+    FrameTiming::EndFrame();
 }
 
 void VulkanRenderer::RecreateSwapChain()    
@@ -1462,19 +3568,57 @@ void VulkanRenderer::RecreateSwapChain()
         glfwGetFramebufferSize(window, &width, &height);
         glfwWaitEvents();
     }
-    vkDeviceWaitIdle(s_VulkanData.device);
 
-    CleanUpSwapChain(); 
+    // No wait for the GPU, frames in flight keep using the old objects until they retire.
+    // The old swapchain stays alive for CreateSwapChain to hand over as oldSwapchain.
+    VkDevice device = s_VulkanData.device;
+    VkSwapchainKHR swapChain = s_VulkanData.swapChain;
+    std::vector<VkImageView> imageViews = std::move(s_VulkanData.swapChainImageViews);
+    VkFramebuffer framebuffer = s_VulkanData.swapChainFramebuffer;
+    DepthBuffer depth = s_VulkanData.swapChainDepth;
+    DeferDestruction([=]()
+    {
+        vkDestroyFramebuffer(device, framebuffer, nullptr);
+        DestroyDepthBuffer(device, depth);
+        for (VkImageView imageView : imageViews)
+            vkDestroyImageView(device, imageView, nullptr);
+        vkDestroySwapchainKHR(device, swapChain, nullptr);
+    });
+
+    s_VulkanData.swapChainImageViews.clear();
+    s_VulkanData.swapChainFramebuffer = VK_NULL_HANDLE;
 
     CreateSwapChain();  
     CreateImageViews();   
+    CreateDepthResources();
     CreateFramebuffers();   
+
+    if (s_VulkanData.EnableImGui)
+        ImGui_ImplVulkan_SetMinImageCount(static_cast<uint32_t>(s_VulkanData.swapChainImages.size()));
+}
+
+void VulkanRenderer::DestroyRetiredObjects(bool all)
+{
+    // After waiting on this slot's fence every frame up to frameNumber - MAX_FRAMES_IN_FLIGHT has completed
+    auto& deferredDestructions = s_VulkanData.deferredDestructions;
+    auto remaining = std::remove_if(deferredDestructions.begin(), deferredDestructions.end(), [all](const DeferredDestruction& deferred)
+    {
+        if (!all && deferred.lastUsedFrame + MAX_FRAMES_IN_FLIGHT > s_VulkanData.frameNumber)
+            return false;
+
+        deferred.destroy();
+        return true;
+    });
+    deferredDestructions.erase(remaining, deferredDestructions.end());
 }
      
 void VulkanRenderer::CleanUpSwapChain() 
 {
-    for (size_t i = 0; i < s_VulkanData.swapChainFramebuffers.size(); i++)
-        vkDestroyFramebuffer(s_VulkanData.device, s_VulkanData.swapChainFramebuffers[i], nullptr);
+    DestroyRetiredObjects(true);
+
+    // Null with dynamic rendering, which destroying accepts
+    vkDestroyFramebuffer(s_VulkanData.device, s_VulkanData.swapChainFramebuffer, nullptr);
+    DestroyDepthBuffer(s_VulkanData.device, s_VulkanData.swapChainDepth);
     
     for (size_t i = 0; i < s_VulkanData.swapChainImageViews.size(); i++)
         vkDestroyImageView(s_VulkanData.device, s_VulkanData.swapChainImageViews[i], nullptr);
@@ -1484,17 +3628,36 @@ void VulkanRenderer::CleanUpSwapChain()
 
 void VulkanRenderer::Cleanup()
 {   
+    // Shutdown is the one place a full stall is fine, nothing below may still be in use
+    vkDeviceWaitIdle(s_VulkanData.device);
+
+    // Destroyed with the retired swapchains, before the ImGui pool the viewport's descriptors came from
+    RetireOffscreenTargets(s_VulkanData.viewportTargets, &s_VulkanData.viewportTextures);
+    RetireOffscreenTargets(s_VulkanData.sceneColorTargets);
     CleanUpSwapChain(); 
-    vkDestroySampler(s_VulkanData.device, s_VulkanData.textureSampler, nullptr);
+    SamplerCache::Shutdown();
+    TextureManager::Shutdown();
+
+    vkDestroyBuffer(s_VulkanData.device, s_VulkanData.materialBuffer, nullptr);
+    vkFreeMemory(s_VulkanData.device, s_VulkanData.materialBufferMemory, nullptr);
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        vkDestroyBuffer(s_VulkanData.device, s_VulkanData.instanceBuffers[i], nullptr);
+        vkFreeMemory(s_VulkanData.device, s_VulkanData.instanceBuffersMemory[i], nullptr);
+    }
+    BindlessDescriptors::Shutdown();
  
-    for (size_t i = 0; i < s_VulkanData.swapChainImages.size(); i++)  
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)  
     {
         vkDestroyBuffer(s_VulkanData.device, s_VulkanData.uniformBuffers[i], nullptr);
         vkFreeMemory(s_VulkanData.device, s_VulkanData.uniformBuffersMemory[i], nullptr);
     }
   
-    vkDestroyDescriptorPool(s_VulkanData.device, s_VulkanData.descriptorPool, nullptr);
-    vkDestroyDescriptorSetLayout(s_VulkanData.device, s_VulkanData.descriptorSetLayout, nullptr);
+    s_VulkanData.descriptorAllocator.Destroy();
+    for (DescriptorAllocator& allocator : s_VulkanData.frameDescriptorAllocators)
+        allocator.Destroy();
+    DescriptorAllocator::DestroySetLayout(s_VulkanData.device, s_VulkanData.descriptorSetLayout);
 
     vkDestroyBuffer(s_VulkanData.device, s_VulkanData.indexBuffer, nullptr);
     vkFreeMemory(s_VulkanData.device, s_VulkanData.indexBufferMemory, nullptr);
@@ -1502,20 +3665,54 @@ void VulkanRenderer::Cleanup()
     vkDestroyBuffer(s_VulkanData.device, s_VulkanData.vertexBuffer, nullptr);
     vkFreeMemory(s_VulkanData.device, s_VulkanData.vertexBufferMemory, nullptr);
 
+    vkDestroyBuffer(s_VulkanData.device, s_VulkanData.positionBuffer, nullptr);
+    vkFreeMemory(s_VulkanData.device, s_VulkanData.positionBufferMemory, nullptr);
+
+    if (s_VulkanData.EnableMeshletCulling)
+    {
+        vkDestroyPipeline(s_VulkanData.device, s_VulkanData.meshletCullPipeline, nullptr);
+        vkDestroyPipelineLayout(s_VulkanData.device, s_VulkanData.meshletCullPipelineLayout, nullptr);
+        DescriptorAllocator::DestroySetLayout(s_VulkanData.device, s_VulkanData.meshletCullSetLayout);
+
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        {
+            vkDestroyBuffer(s_VulkanData.device, s_VulkanData.compactedIndexBuffers[i], nullptr);
+            vkFreeMemory(s_VulkanData.device, s_VulkanData.compactedIndexBuffersMemory[i], nullptr);
+            vkDestroyBuffer(s_VulkanData.device, s_VulkanData.drawCommandBuffers[i], nullptr);
+            vkFreeMemory(s_VulkanData.device, s_VulkanData.drawCommandBuffersMemory[i], nullptr);
+        }
+
+        vkDestroyBuffer(s_VulkanData.device, s_VulkanData.meshletBuffer, nullptr);
+        vkFreeMemory(s_VulkanData.device, s_VulkanData.meshletBufferMemory, nullptr);
+        vkDestroyBuffer(s_VulkanData.device, s_VulkanData.meshletVertexBuffer, nullptr);
+        vkFreeMemory(s_VulkanData.device, s_VulkanData.meshletVertexBufferMemory, nullptr);
+        vkDestroyBuffer(s_VulkanData.device, s_VulkanData.meshletTriangleBuffer, nullptr);
+        vkFreeMemory(s_VulkanData.device, s_VulkanData.meshletTriangleBufferMemory, nullptr);
+    }
+
     if (s_VulkanData.EnableImGui)
         ImGuiShutdown();
 
-    for (size_t i = 0; i < s_VulkanData.swapChainImages.size(); i++)  
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)  
     {
         vkDestroySemaphore(s_VulkanData.device, s_VulkanData.renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(s_VulkanData.device, s_VulkanData.imageAvailableSemaphores[i], nullptr);
         vkDestroyFence(s_VulkanData.device, s_VulkanData.inFlightFences[i], nullptr);
     }
     vkDestroyPipeline(s_VulkanData.device, s_VulkanData.graphicsPipeline, nullptr);
+    vkDestroyPipeline(s_VulkanData.device, s_VulkanData.depthEqualPipeline, nullptr);
+    vkDestroyPipeline(s_VulkanData.device, s_VulkanData.depthPrepassPipeline, nullptr);
     vkDestroyPipelineLayout(s_VulkanData.device, s_VulkanData.pipelineLayout, nullptr);
     vkDestroyRenderPass(s_VulkanData.device, s_VulkanData.renderPass, nullptr);
+
+    vkDestroyPipeline(s_VulkanData.device, s_VulkanData.upscalePipeline, nullptr);
+    vkDestroyPipelineLayout(s_VulkanData.device, s_VulkanData.upscalePipelineLayout, nullptr);
+    DescriptorAllocator::DestroySetLayout(s_VulkanData.device, s_VulkanData.upscaleSetLayout);
+    vkDestroyRenderPass(s_VulkanData.device, s_VulkanData.offscreenRenderPass, nullptr);
+    vkDestroyQueryPool(s_VulkanData.device, s_VulkanData.timestampQueryPool, nullptr);
  
     vkDestroyCommandPool(s_VulkanData.device, s_VulkanData.commandPool, nullptr);
+    Shader::Shutdown();
 
     vkDestroySurfaceKHR(s_VulkanData.instance, s_VulkanData.surface, nullptr);
     vkDestroyDevice(s_VulkanData.device, nullptr);    
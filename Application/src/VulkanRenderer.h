@@ -2,6 +2,26 @@
 
 #include <stdint.h> 
 
+class EntityRegistry;
+
+// Mesh table index of the built-in quad, usable in MeshRef
+const uint32_t QUAD_MESH = 0;
+
+// How finished frames are handed to the display
+enum class PresentPolicy
+{
+	LowLatency,	// MAILBOX, or IMMEDIATE which may tear, newest frame wins
+	PowerSaving,	// FIFO, never renders faster than the display refreshes
+	Adaptive	// FIFO_RELAXED, v-synced but a late frame is shown at once instead of a refresh later
+};
+
+// How a scene rendered below the output resolution is stretched to it
+enum class Upscaler
+{
+	Bilinear,
+	EdgeAdaptive	// Bilinear plus contrast adaptive sharpening, restores edges without ringing
+};
+
 class VulkanRenderer
 {
 public:
@@ -13,6 +33,8 @@ public:
 	static void CreateLogicalDevice();
 	static void CreateSwapChain();
 	static void CreateImageViews();
+	// Depth buffer of the swapchain's size, follows it through RecreateSwapChain
+	static void CreateDepthResources();
 	static void CreateRenderPass();
 
 	static void CreateDescriptorSetLayout();
@@ -30,20 +52,58 @@ public:
 
 	static void CreateVertexBuffer();
 	static void CreateIndexBuffer(); 
+	static void CreatePositionBuffer();
+
+	static void CreateMaterialBuffer();
+	static void CreateInstanceBuffers();
+
+	static void CreateMeshletBuffers();
+	static void CreateMeshletCullPipeline();
+
+	static void CreateUpscalePipeline();
+	static void CreateTimestampQueries();
 
-	static void CreateViewportImages();
-	static void CreateViewportImageViews(); 
 	static void CreateViewportTextureSampler(); 
-	static void CreateViewportRenderPass();  
-	static void CreateViewportPipeline();  
-	static void CreateViewportCommandPool();
-	static void CreateViewportFramebuffers();
-	static void CreateViewportCommandBuffers();
+	static void CreateOffscreenRenderPass();  
+	static void CreateViewportTextures();
+	// Replaces the scene's offscreen targets with ones of the given size, the old ones retire with their frames
+	static void ResizeViewport(uint32_t width, uint32_t height);
 
-	static void UpdateUniformBuffer(uint32_t currentImage);
+	// Rebuilds view/projection only when the camera or extent changed and writes the stale blocks of this frame's buffer
+	static void UpdateUniformBuffer(uint32_t frameIndex);
 	static void OnUpdate(); 
 
+	// Entities with Transform, MeshRef, MaterialRef and Bounds are drawn every frame. Simulation thread only,
+	// between BeginSimulationStep and PublishSnapshot.
+	static EntityRegistry& GetEntities();
+	// Applies entity edits queued by the UI, call at the start of every fixed step
+	static void BeginSimulationStep();
+	// Copies the renderable entities into a snapshot the render thread picks up on its next frame
+	static void PublishSnapshot(uint64_t simulationFrame, double simulationTime);
+	static uint32_t GetDefaultMaterial();
+
+	// Both are applied by recreating the swapchain at the start of the next frame
+	static void SetPresentPolicy(PresentPolicy policy);
+	static PresentPolicy GetPresentPolicy();
+	// 0 picks a count that suits the present mode, other counts are clamped to what the surface supports
+	static void SetSwapchainImageCount(uint32_t imageCount);
+	// Seconds from an input event to the present of the first frame that saw it, plus the expected wait for
+	// scanout. Smoothed, 0 until some input was presented.
+	static double GetInputToPresentLatency();
+
+	// Dynamic resolution renders the scene at a per axis scale of the output picked from its measured GPU time,
+	// so the frame fits the frame rate cap or the display's refresh interval, and upscales it to the output.
+	// Without GPU timestamps the scale stays at the upper bound.
+	static void SetDynamicResolution(bool enabled);
+	// Both are clamped to [0.25, 1], the upper bound decides the size of the scene's render targets
+	static void SetResolutionScaleBounds(float minScale, float maxScale);
+	static void SetUpscaler(Upscaler upscaler);
+	static float GetResolutionScale();
+
+	// Builds a new swapchain from the current one without waiting for the GPU, see DestroyRetiredObjects
 	static void RecreateSwapChain();
+	// Destroys replaced swapchains and viewport targets whose frames have retired, or all of them when the device is idle
+	static void DestroyRetiredObjects(bool all);
 	static void CleanUpSwapChain();
 	static void Cleanup(); 
 public:
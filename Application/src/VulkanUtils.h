@@ -2,6 +2,7 @@
 #include "vulkan/vulkan.h"
 #include "GLFW/glfw3.h"
 #include "spdlog/spdlog.h"
+#include "Core.h"
 
 #include <iostream>
 #include <vector>
@@ -73,9 +74,6 @@ uint32_t glfwExtensionCount = 0;
 const char** glfwExtensions;
 uint32_t extensionCount = 0;
 
-#define DEBUG_BREAK __debugbreak();
-#define Print(x) spdlog::info(x);
-#define CheckForError(x,y) if(x) { spdlog::error(y); DEBUG_BREAK }
 
 namespace Utils
 {
@@ -182,6 +180,24 @@ namespace Utils
         return indices;
     }
 
+    // Optional extensions, enabled only when the device has them
+    bool isDeviceExtensionSupported(VkPhysicalDevice device, const char* extensionName)
+    {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+        for (const auto& extension : availableExtensions)
+        {
+            if (strcmp(extension.extensionName, extensionName) == 0)
+                return true;
+        }
+
+        return false;
+    }
+
     bool checkDeviceExtensionSupport(VkPhysicalDevice device) 
     {
         uint32_t extensionCount;
@@ -254,21 +270,41 @@ namespace Utils
             return availableFormats[0];
         }
 
-        VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
+        VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes, PresentPolicy policy)
         {
-            // Iterate through the available presentation modes
-            for (const auto& availablePresentMode : availablePresentModes)
+            // Modes in order of preference for each policy, FIFO is the one mode every device has to support
+            std::vector<VkPresentModeKHR> preferred;
+            switch (policy)
             {
-                // Check if the mailbox presentation mode is available
-                if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
-                    return availablePresentMode;
+            case PresentPolicy::LowLatency:  preferred = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR }; break;
+            case PresentPolicy::Adaptive:    preferred = { VK_PRESENT_MODE_FIFO_RELAXED_KHR }; break;
+            case PresentPolicy::PowerSaving: break;
+            }
 
+            for (VkPresentModeKHR mode : preferred)
+            {
+                if (std::find(availablePresentModes.begin(), availablePresentModes.end(), mode) != availablePresentModes.end())
+                    return mode;
             }
 
-            // If mailbox presentation mode is not available, fallback to FIFO mode
             return VK_PRESENT_MODE_FIFO_KHR;
         }
 
+        uint32_t chooseSwapImageCount(const VkSurfaceCapabilitiesKHR& capabilities, VkPresentModeKHR presentMode, uint32_t requestedCount)
+        {
+            // MAILBOX needs a spare image to replace queued frames with. Plain FIFO at the minimum count queues
+            // the fewest frames, the CPU blocks sooner and the GPU idles more.
+            uint32_t imageCount = requestedCount;
+            if (imageCount == 0)
+                imageCount = presentMode == VK_PRESENT_MODE_FIFO_KHR ? capabilities.minImageCount : capabilities.minImageCount + 1;
+
+            imageCount = std::max(imageCount, capabilities.minImageCount);
+            if (capabilities.maxImageCount > 0)
+                imageCount = std::min(imageCount, capabilities.maxImageCount);
+
+            return imageCount;
+        }
+
         VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
         {
             // Check if the current extent is already set to a specific value
@@ -299,6 +335,38 @@ namespace Utils
 
     }
 
+    // The bindless set needs core 1.2 descriptor indexing: runtime arrays, partially bound and update-after-bind
+    // descriptors, non-uniform texture indexing
+    bool isDescriptorIndexingSupported(VkPhysicalDevice device)
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(device, &properties);
+
+        // The feature struct below is only valid to query on a device that reports 1.2
+        if (properties.apiVersion < VK_API_VERSION_1_2)
+        {
+            spdlog::warn("Skipping {}, it only supports Vulkan {}.{}", properties.deviceName, VK_VERSION_MAJOR(properties.apiVersion), VK_VERSION_MINOR(properties.apiVersion));
+            return false;
+        }
+
+        VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &indexingFeatures;
+        vkGetPhysicalDeviceFeatures2(device, &features2);
+
+        bool supported = indexingFeatures.runtimeDescriptorArray && indexingFeatures.descriptorBindingPartiallyBound &&
+            indexingFeatures.shaderSampledImageArrayNonUniformIndexing && indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+            indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind;
+
+        if (!supported)
+            spdlog::warn("Skipping {}, it lacks the descriptor indexing features the bindless set needs", properties.deviceName);
+
+        return supported;
+    }
+
     bool isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface)
     {
         QueueFamilyIndices indices = findQueueFamilies(device, surface);
@@ -312,6 +380,24 @@ namespace Utils
             swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
         }
 
-        return indices.isComplete() && extensionsSupported && swapChainAdequate;
+        return indices.isComplete() && extensionsSupported && swapChainAdequate && isDescriptorIndexingSupported(device);
+    }
+
+    // Most precise depth-only format the device can render depth into with optimal tiling. D16 is always
+    // supported, so VK_FORMAT_UNDEFINED never comes back from a conformant device.
+    VkFormat findDepthFormat(VkPhysicalDevice device)
+    {
+        const VkFormat candidates[] = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D16_UNORM };
+
+        for (VkFormat format : candidates)
+        {
+            VkFormatProperties properties;
+            vkGetPhysicalDeviceFormatProperties(device, format, &properties);
+
+            if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+                return format;
+        }
+
+        return VK_FORMAT_UNDEFINED;
     }
 }
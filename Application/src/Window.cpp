@@ -1,4 +1,29 @@
 #include "Window.h"
+#include "FrameTiming.h"
+
+// ImGui settles hover and focus state over a few frames after the input that caused it
+static const uint32_t INPUT_REDRAW_FRAMES = 3;
+// Upper bound on an idle wait, so time based UI (e.g. a blinking text cursor) still gets the odd frame
+static const double IDLE_WAIT_TIMEOUT = 0.5;
+
+// Raises the pending frame count to at least 'frames', never lowers a larger request
+static void RequestFrames(std::atomic<uint32_t>& pending, uint32_t frames)
+{
+	uint32_t current = pending.load();
+	while (current < frames && !pending.compare_exchange_weak(current, frames))
+	{
+	}
+}
+
+void Window::OnInput(GLFWwindow* window)
+{
+	WindowData& data = *(WindowData*)glfwGetWindowUserPointer(window);
+	if (data.pendingInputTime == 0.0)
+		data.pendingInputTime = FrameTiming::Now();
+
+	RequestFrames(data.pendingRedrawFrames, INPUT_REDRAW_FRAMES);
+}
+
 Window::Window(WindowProps props)
 {
 	windowData.w_TITLE = props.TITLE;
@@ -25,6 +50,28 @@ void Window::GLFWCallbackFunctionalities()
     {
 			WindowData& data = *(WindowData*)glfwGetWindowUserPointer(window);
 			data.framebufferResized = true;	
+			data.lastResizeTime = glfwGetTime();
+			RequestFrames(data.pendingRedrawFrames, INPUT_REDRAW_FRAMES);
+	});
+
+	// Any input may change the UI. These are installed before ImGui's, which chains to them.
+	glfwSetCursorPosCallback(window, [](GLFWwindow* window, double x, double y) { OnInput(window); });
+	glfwSetMouseButtonCallback(window, [](GLFWwindow* window, int button, int action, int mods) { OnInput(window); });
+	glfwSetScrollCallback(window, [](GLFWwindow* window, double x, double y) { OnInput(window); });
+	glfwSetKeyCallback(window, [](GLFWwindow* window, int key, int scancode, int action, int mods) { OnInput(window); });
+	glfwSetCharCallback(window, [](GLFWwindow* window, unsigned int codepoint) { OnInput(window); });
+	glfwSetWindowFocusCallback(window, [](GLFWwindow* window, int focused)
+	{
+			RequestFrames(((WindowData*)glfwGetWindowUserPointer(window))->pendingRedrawFrames, INPUT_REDRAW_FRAMES);
+	});
+	glfwSetCursorEnterCallback(window, [](GLFWwindow* window, int entered)
+	{
+			RequestFrames(((WindowData*)glfwGetWindowUserPointer(window))->pendingRedrawFrames, INPUT_REDRAW_FRAMES);
+	});
+	// The window was uncovered or restored and its contents have to be presented again
+	glfwSetWindowRefreshCallback(window, [](GLFWwindow* window)
+	{
+			RequestFrames(((WindowData*)glfwGetWindowUserPointer(window))->pendingRedrawFrames, 1);
 	});
 }
 
@@ -35,7 +82,41 @@ Window::WindowData* Window::GetData()
  
 void Window::OnUpdate()
 {
-	glfwPollEvents();
+	if (windowData.onDemandRendering && windowData.pendingRedrawFrames.load() == 0)
+		glfwWaitEventsTimeout(IDLE_WAIT_TIMEOUT);
+	else
+		glfwPollEvents();
+}
+
+void Window::SetOnDemandRendering(bool enabled)
+{
+	windowData.onDemandRendering = enabled;
+	Invalidate();
+}
+
+void Window::Invalidate(uint32_t frames)
+{
+	RequestFrames(windowData.pendingRedrawFrames, frames);
+
+	// Wakes the main thread if it is sleeping in glfwWaitEventsTimeout
+	glfwPostEmptyEvent();
+}
+
+double Window::ConsumeInputTime()
+{
+	double time = windowData.pendingInputTime;
+	windowData.pendingInputTime = 0.0;
+	return time;
+}
+
+bool Window::ConsumeRedraw()
+{
+	uint32_t current = windowData.pendingRedrawFrames.load();
+	while (current > 0 && !windowData.pendingRedrawFrames.compare_exchange_weak(current, current - 1))
+	{
+	}
+
+	return current > 0;
 }
 
 void Window::Close(bool& running)
@@ -2,6 +2,7 @@
 
 #include "GLFW/glfw3.h"
 #include <string>
+#include <atomic>
 
 struct WindowProps
 {
@@ -26,10 +27,23 @@ public:
 
 	void GLFWCallbackFunctionalities();
 
+	// Polls events, or in on-demand mode sleeps until an event arrives when no redraw is pending
 	void OnUpdate();
 
 	GLFWwindow* GLFW() { return window; }
 
+	// In on-demand mode frames are only drawn after something invalidated the window
+	void SetOnDemandRendering(bool enabled);
+	bool IsOnDemandRendering() const { return windowData.onDemandRendering; }
+
+	// Requests 'frames' more frames, safe to call from any thread
+	void Invalidate(uint32_t frames = 1);
+	// Takes one pending frame, false when nothing asked for a redraw
+	bool ConsumeRedraw();
+
+	// FrameTiming time of the oldest input since the last call, 0 when there was none
+	double ConsumeInputTime();
+
 	void Close(bool& running);
 private:
 
@@ -39,8 +53,17 @@ private:
 		uint32_t w_WIDTH;
 		uint32_t w_HEIGHT;
 		bool framebufferResized = false;
+		// glfwGetTime of the latest resize event, the renderer waits for resizing to settle before rebuilding
+		double lastResizeTime = 0.0;
+
+		bool onDemandRendering = false;
+		std::atomic<uint32_t> pendingRedrawFrames{ 1 };
+		double pendingInputTime = 0.0;
 	};
 
+	// Remembers when the oldest input that no frame has seen yet arrived, for latency measurement
+	static void OnInput(GLFWwindow* window);
+
 public:
 	WindowData* GetData();
 private:
@@ -1,5 +1,7 @@
 @echo off
 pushd %~dp0\..\
+rem Dear ImGui is pinned, InitImGui is written against this release's Vulkan backend
+if not exist Application\Vendor\imgui\imgui.h git clone --depth 1 --branch v1.90.9-docking https://github.com/ocornut/imgui Application\Vendor\imgui
 call Application\Premake\premake5.exe vs2022
 popd
 PAUSE
@@ -4,6 +4,7 @@ IncludeDir["GLFW"] =  "%{wks.location}/Application/Vendor/GLFW/include"
 IncludeDir["GLM"] = "%{wks.location}/Application/Vendor/GLM"
 IncludeDir["Spdlog"] = "%{wks.location}/Application/Vendor/Spdlog/include"
 --IncludeDir["STBImage"] = "%{wks.location}/Application/Vendor/stb"
+-- Dear ImGui v1.90.9-docking, cloned by Scripts/Win-GenProjects.bat
 IncludeDir["imgui"] = "%{wks.location}/Application/Vendor/imgui"
 --IncludeDir["tol"] = "%{wks.location}/Application/Vendor/tinyobjloader"
 